@@ -16,6 +16,8 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -40,34 +42,131 @@ class controller_impl final
       void open( const std::filesystem::path& p, const std::any& o, const genesis_data& data, bool reset );
       void set_client( std::shared_ptr< mq::client > c );
 
-      rpc::chain::submit_block_response       submit_block(       const rpc::chain::submit_block_request&, bool indexing );
+      rpc::chain::submit_block_response       submit_block(       const rpc::chain::submit_block_request&, bool indexing, block_timing* timing );
       rpc::chain::submit_transaction_response submit_transaction( const rpc::chain::submit_transaction_request& );
       rpc::chain::get_head_info_response      get_head_info(      const rpc::chain::get_head_info_request&      );
       rpc::chain::get_chain_id_response       get_chain_id(       const rpc::chain::get_chain_id_request&      );
       rpc::chain::get_fork_heads_response     get_fork_heads(     const rpc::chain::get_fork_heads_request&     );
 
+      void begin_bulk_sync( uint64_t commit_interval );
+      void end_bulk_sync();
+
+      void export_snapshot( const std::filesystem::path& p );
+      void import_snapshot( const std::filesystem::path& p );
+
+      statedb::state_db_metrics get_metrics()const;
+
    private:
+      static constexpr uint64_t max_state_delta_depth = 8;
+
       statedb::state_db             _state_db;
       std::mutex                    _state_db_mutex;
       std::shared_ptr< mq::client > _client;
 
+      bool                          _bulk_sync = false;
+      uint64_t                      _bulk_commit_interval = 0;
+      uint64_t                      _bulk_lib = 0;
+
+      // The newest block whose state should be flattened, see flatten_worker()
+      std::optional< statedb::state_node_id > _flatten_request;
+      bool                                    _flattening = false;
+      bool                                    _stop_flatten = false;
+      std::mutex                              _flatten_mutex;
+      std::condition_variable                 _flatten_cv;
+      std::thread                             _flatten_thread;
+
       fork_data get_fork_data();
+
+      void request_flatten( const statedb::state_node_id& id );
+      void wait_for_flatten();
+      void flatten_worker();
 };
 
 controller_impl::controller_impl()
 {
    register_host_functions();
+   _flatten_thread = std::thread( [&]{ flatten_worker(); } );
 }
 
 controller_impl::~controller_impl()
 {
+   {
+      std::lock_guard< std::mutex > lock( _flatten_mutex );
+      _stop_flatten = true;
+      _flatten_cv.notify_all();
+   }
+
+   _flatten_thread.join();
+
    std::lock_guard< std::mutex > lock( _state_db_mutex );
-   _state_db.close();
+
+   try
+   {
+      _state_db.close();
+   }
+   catch ( const std::exception& e )
+   {
+      LOG(error) << "Irreversible state was not written to disk before shutdown: " << e.what();
+   }
+}
+
+void controller_impl::request_flatten( const statedb::state_node_id& id )
+{
+   std::lock_guard< std::mutex > lock( _flatten_mutex );
+   _flatten_request = id;
+   _flatten_cv.notify_all();
+}
+
+void controller_impl::wait_for_flatten()
+{
+   std::unique_lock< std::mutex > lock( _flatten_mutex );
+   _flatten_request.reset();
+   _flatten_cv.wait( lock, [&]{ return !_flattening; } );
+}
+
+/*
+ * Keeps reads on top of the newest block from walking every reversible block.
+ *
+ * Merging the chain copies every change since root, so it runs here rather
+ * than on the block's critical path. Only the newest request is kept, a
+ * flattened block bounds the depth of the blocks built on it as well.
+ */
+void controller_impl::flatten_worker()
+{
+   std::unique_lock< std::mutex > lock( _flatten_mutex );
+
+   while ( true )
+   {
+      _flatten_cv.wait( lock, [&]{ return _stop_flatten || _flatten_request; } );
+
+      if ( _stop_flatten )
+         return;
+
+      auto id = *_flatten_request;
+      _flatten_request.reset();
+      _flattening = true;
+      lock.unlock();
+
+      try
+      {
+         _state_db.flatten_node( id, max_state_delta_depth );
+      }
+      catch ( const std::exception& e )
+      {
+         // Reads fall back to the unflattened chain, which stays correct but slower
+         LOG(warning) << "Unable to flatten state at block " << id << ": " << e.what();
+      }
+
+      lock.lock();
+      _flattening = false;
+      _flatten_cv.notify_all();
+   }
 }
 
 void controller_impl::open( const std::filesystem::path& p, const std::any& o, const genesis_data& data, bool reset )
 {
    std::lock_guard< std::mutex > lock( _state_db_mutex );
+   wait_for_flatten();
    _state_db.open( p, o, [&]( statedb::state_node_ptr root )
    {
       for ( const auto& entry : data )
@@ -105,10 +204,19 @@ void controller_impl::set_client( std::shared_ptr< mq::client > c )
    _client = c;
 }
 
-rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chain::submit_block_request& request, bool indexing )
+rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chain::submit_block_request& request, bool indexing, block_timing* timing )
 {
    static constexpr uint64_t index_message_interval = 10000;
 
+   auto phase_start = std::chrono::steady_clock::now();
+   auto end_phase = [&]( std::chrono::nanoseconds block_timing::* phase )
+   {
+      if ( !timing ) return;
+      auto now = std::chrono::steady_clock::now();
+      (*timing).*phase += now - phase_start;
+      phase_start = now;
+   };
+
    if( crypto::multihash_is_zero( request.block.header.previous ) )
    {
       // Genesis case
@@ -133,6 +241,8 @@ rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chai
       KOINOS_ASSERT( block_node, unknown_previous_block, "Unknown previous block" );
    }
 
+   end_phase( &block_timing::create_node );
+
    try
    {
       apply_context ctx;
@@ -150,6 +260,8 @@ rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chai
          request.verify_block_signature,
          request.verify_transaction_signatures );
 
+      end_phase( &block_timing::apply_block );
+
       if ( !indexing || request.block.header.height % index_message_interval == 0 )
       {
          LOG(info) << "Block application successful - Height: " << request.block.header.height << ", ID: " << request.block.id;
@@ -169,13 +281,35 @@ rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chai
          _state_db.finalize_node( block_node->id() );
 
          std::optional< state_node_ptr > node;
-         if ( lib > _state_db.get_root()->revision() )
+         auto root_revision = _state_db.get_root()->revision();
+
+         if ( _bulk_sync )
+         {
+            // Irreversible blocks are committed in batches while bulk syncing
+            _bulk_lib = std::max( _bulk_lib, uint64_t( lib ) );
+
+            if ( _bulk_lib >= root_revision + _bulk_commit_interval )
+            {
+               node = _state_db.get_node_at_revision( _bulk_lib, block_node->id() );
+               _state_db.commit_node( node.value()->id() );
+            }
+         }
+         else if ( lib > root_revision )
          {
             node = _state_db.get_node_at_revision( uint64_t( lib ), block_node->id() );
             _state_db.commit_node( node.value()->id() );
          }
+
+         // Root advances only every commit interval while bulk syncing, so the
+         // chain is not flattened there. Finalized deltas already answer lookups
+         // by id from their view, and flattening would copy the whole interval
+         // on every block.
+         if ( !_bulk_sync )
+            request_flatten( block_node->id() );
       }
 
+      end_phase( &block_timing::commit );
+
       const auto [ fork_heads, last_irreversible_block ] = get_fork_data();
 
       if ( _client && _client->is_connected() )
@@ -226,6 +360,8 @@ rpc::chain::submit_block_response controller_impl::submit_block( const rpc::chai
             LOG(error) << "Failed to publish fork data to message broker: " << e.what();
          }
       }
+
+      end_phase( &block_timing::publish );
    }
    catch( const koinos::exception& )
    {
@@ -354,10 +490,7 @@ rpc::chain::get_head_info_response controller_impl::get_head_info( const rpc::ch
       .call_privilege = privilege::kernel_mode
    } );
 
-   {
-      std::lock_guard< std::mutex > lock( _state_db_mutex );
-      ctx.set_state_node( _state_db.get_head() );
-   }
+   ctx.set_state_node( _state_db.get_head() );
 
    auto head_info = system_call::get_head_info( ctx );
    return {
@@ -380,14 +513,7 @@ rpc::chain::get_chain_id_response controller_impl::get_chain_id( const rpc::chai
    args.buf      = const_cast< char* >( chain_id_stream.vector().data() );
    args.buf_size = chain_id_stream.vector().size();
 
-   statedb::state_node_ptr head;
-
-   {
-      std::lock_guard< std::mutex > lock( _state_db_mutex );
-      head = _state_db.get_head();
-   }
-
-   head->get_object( result, args );
+   _state_db.get_head()->get_object( result, args );
 
    KOINOS_ASSERT( result.key == args.key, retrieval_failure, "unable to retrieve chain id" );
    KOINOS_ASSERT( result.size <= args.buf_size, insufficent_buffer_size, "chain id buffer overflow" );
@@ -412,6 +538,7 @@ fork_data controller_impl::get_fork_data()
    std::vector< statedb::state_node_ptr > fork_heads;
 
    {
+      // Root and fork heads need to come from the same state of the fork tree
       std::lock_guard< std::mutex > lock( _state_db_mutex );
       ctx.set_state_node( _state_db.get_root() );
       fork_heads = _state_db.get_fork_heads();
@@ -460,6 +587,71 @@ rpc::chain::get_fork_heads_response controller_impl::get_fork_heads( const rpc::
    return response;
 }
 
+void controller_impl::begin_bulk_sync( uint64_t commit_interval )
+{
+   std::lock_guard< std::mutex > lock( _state_db_mutex );
+   KOINOS_ASSERT( commit_interval > 0, controller_exception, "Bulk sync commit interval must be positive" );
+   wait_for_flatten();
+
+   _bulk_sync = true;
+   _bulk_commit_interval = commit_interval;
+   _bulk_lib = _state_db.get_root()->revision();
+   _state_db.begin_bulk_load();
+}
+
+void controller_impl::end_bulk_sync()
+{
+   std::lock_guard< std::mutex > lock( _state_db_mutex );
+
+   if ( !_bulk_sync )
+      return;
+
+   if ( _bulk_lib > _state_db.get_root()->revision() )
+   {
+      auto node = _state_db.get_node_at_revision( _bulk_lib );
+      _state_db.commit_node( node->id() );
+   }
+
+   _state_db.end_bulk_load();
+   _state_db.flush();
+   _bulk_sync = false;
+
+   LOG(info) << "Checkpointed state at block " << _state_db.get_root()->revision();
+}
+
+void controller_impl::export_snapshot( const std::filesystem::path& p )
+{
+   std::lock_guard< std::mutex > lock( _state_db_mutex );
+
+   std::ofstream out( p, std::ios::binary );
+   KOINOS_ASSERT( out.is_open(), controller_exception, "Unable to open snapshot file ${f}", ("f", p.string()) );
+
+   auto root = _state_db.get_root();
+   LOG(info) << "Exporting snapshot at block - Height: " << root->revision() << ", ID: " << root->id();
+   _state_db.export_snapshot( root->id(), out );
+   LOG(info) << "Wrote snapshot to " << p.string();
+}
+
+void controller_impl::import_snapshot( const std::filesystem::path& p )
+{
+   std::lock_guard< std::mutex > lock( _state_db_mutex );
+
+   std::ifstream in( p, std::ios::binary );
+   KOINOS_ASSERT( in.is_open(), controller_exception, "Unable to open snapshot file ${f}", ("f", p.string()) );
+
+   LOG(info) << "Importing snapshot from " << p.string();
+   _state_db.import_snapshot( in );
+
+   auto root = _state_db.get_root();
+   LOG(info) << "Imported snapshot at block - Height: " << root->revision() << ", ID: " << root->id();
+}
+
+statedb::state_db_metrics controller_impl::get_metrics()const
+{
+   // state_db is safe to read concurrently, metrics do not wait on block application
+   return _state_db.get_metrics();
+}
+
 } // detail
 
 controller::controller() : _my( std::make_unique< detail::controller_impl >() ) {}
@@ -476,9 +668,9 @@ void controller::set_client( std::shared_ptr< mq::client > c )
    _my->set_client( c );
 }
 
-rpc::chain::submit_block_response controller::submit_block( const rpc::chain::submit_block_request& request, bool indexing )
+rpc::chain::submit_block_response controller::submit_block( const rpc::chain::submit_block_request& request, bool indexing, block_timing* timing )
 {
-   return _my->submit_block( request, indexing );
+   return _my->submit_block( request, indexing, timing );
 }
 
 rpc::chain::submit_transaction_response controller::submit_transaction( const rpc::chain::submit_transaction_request& request )
@@ -501,4 +693,29 @@ rpc::chain::get_fork_heads_response controller::get_fork_heads( const rpc::chain
    return _my->get_fork_heads( request );
 }
 
+void controller::begin_bulk_sync( uint64_t commit_interval )
+{
+   _my->begin_bulk_sync( commit_interval );
+}
+
+void controller::end_bulk_sync()
+{
+   _my->end_bulk_sync();
+}
+
+void controller::export_snapshot( const std::filesystem::path& p )
+{
+   _my->export_snapshot( p );
+}
+
+void controller::import_snapshot( const std::filesystem::path& p )
+{
+   _my->import_snapshot( p );
+}
+
+statedb::state_db_metrics controller::get_metrics()const
+{
+   return _my->get_metrics();
+}
+
 } // koinos::chain
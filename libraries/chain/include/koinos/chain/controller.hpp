@@ -5,6 +5,7 @@
 #include <koinos/pack/classes.hpp>
 
 #include <any>
+#include <chrono>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -18,6 +19,17 @@ using genesis_data = std::map< statedb::object_key, statedb::object_value >;
 #define KOINOS_STATEDB_SPACE        0
 #define KOINOS_STATEDB_CHAIN_ID_KEY 0
 
+/**
+ * Wall clock time spent in each phase of submit_block.
+ */
+struct block_timing
+{
+   std::chrono::nanoseconds create_node{ 0 }; // Creating the block's state node
+   std::chrono::nanoseconds apply_block{ 0 }; // Applying the block and its transactions
+   std::chrono::nanoseconds commit{ 0 };      // Finalizing the node and committing irreversible state
+   std::chrono::nanoseconds publish{ 0 };     // Gathering fork data and broadcasting results
+};
+
 class controller final
 {
    public:
@@ -27,12 +39,42 @@ class controller final
       void open( const std::filesystem::path& p, const std::any& o, const genesis_data& data, bool reset );
       void set_client( std::shared_ptr< mq::client > c );
 
-      rpc::chain::submit_block_response       submit_block(       const rpc::chain::submit_block_request&, bool indexing = false );
+      rpc::chain::submit_block_response       submit_block(       const rpc::chain::submit_block_request&, bool indexing = false, block_timing* timing = nullptr );
       rpc::chain::submit_transaction_response submit_transaction( const rpc::chain::submit_transaction_request&  );
       rpc::chain::get_head_info_response      get_head_info(      const rpc::chain::get_head_info_request&  = {} );
       rpc::chain::get_chain_id_response       get_chain_id(       const rpc::chain::get_chain_id_request&   = {} );
       rpc::chain::get_fork_heads_response     get_fork_heads(     const rpc::chain::get_fork_heads_request& = {} );
 
+      /**
+       * Enter bulk sync mode for initial indexing.
+       *
+       * Irreversible state is committed once every commit_interval blocks
+       * and root state writes are batched until a checkpoint. Reversible
+       * state is not flattened in the meantime.
+       */
+      void begin_bulk_sync( uint64_t commit_interval = 100 );
+
+      /**
+       * Commit through the last irreversible block, write all batched state
+       * and flush it to disk. Safe to call on shutdown to checkpoint state.
+       */
+      void end_bulk_sync();
+
+      /**
+       * Write the irreversible state to a snapshot file.
+       */
+      void export_snapshot( const std::filesystem::path& p );
+
+      /**
+       * Initialize an empty node from a snapshot file.
+       */
+      void import_snapshot( const std::filesystem::path& p );
+
+      /**
+       * Get metrics of the state database.
+       */
+      statedb::state_db_metrics get_metrics()const;
+
    private:
       std::unique_ptr< detail::controller_impl > _my;
 };
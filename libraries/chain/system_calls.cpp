@@ -430,6 +430,26 @@ THUNK_DEFINE( bool, db_put_object, ((const statedb::object_space&) space, (const
    return put_res.object_existed;
 }
 
+/*
+ * Copies an object's value out of the database once. Only the first
+ * object_size_hint bytes of a larger object are copied, the rest are zero.
+ */
+inline variable_blob copy_object_value( const statedb::shared_object& object, int32_t object_size_hint )
+{
+   variable_blob object_buffer;
+
+   if( object.value && object.value->size() > 0 )
+   {
+      uint64_t buf_size = object_size_hint > 0 ? object_size_hint : STATE_DB_MAX_OBJECT_SIZE;
+      uint64_t size = std::min( uint64_t( object.value->size() ), buf_size );
+      object_buffer.reserve( object.value->size() );
+      object_buffer.assign( object.value->begin(), object.value->begin() + size );
+      object_buffer.resize( object.value->size() );
+   }
+
+   return object_buffer;
+}
+
 THUNK_DEFINE( variable_blob, db_get_object, ((const statedb::object_space&) space, (const statedb::object_key&) key, (int32_t) object_size_hint) )
 {
    if ( context.get_privilege() == privilege::kernel_mode )
@@ -441,23 +461,7 @@ THUNK_DEFINE( variable_blob, db_get_object, ((const statedb::object_space&) spac
    auto state = context.get_state_node();
    KOINOS_ASSERT( state, state_node_not_found, "Current state node does not exist" );
 
-   statedb::get_object_args get_args;
-   get_args.space = space;
-   get_args.key = key;
-   get_args.buf_size = object_size_hint > 0 ? object_size_hint : STATE_DB_MAX_OBJECT_SIZE;
-
-   variable_blob object_buffer;
-   object_buffer.resize( get_args.buf_size );
-   get_args.buf = object_buffer.data();
-
-   statedb::get_object_result get_res;
-   state->get_object( get_res, get_args );
-
-   if( get_res.key == get_args.key && get_res.size > 0 )
-      object_buffer.resize( get_res.size );
-   else
-      object_buffer.clear();
-   return object_buffer;
+   return copy_object_value( state->get_shared_object( space, key ), object_size_hint );
 }
 
 THUNK_DEFINE( variable_blob, db_get_next_object, ((const statedb::object_space&) space, (const statedb::object_key&) key, (int32_t) object_size_hint) )
@@ -470,24 +474,8 @@ THUNK_DEFINE( variable_blob, db_get_next_object, ((const statedb::object_space&)
 
    auto state = context.get_state_node();
    KOINOS_ASSERT( state, state_node_not_found, "Current state node does not exist" );
-   statedb::get_object_args get_args;
-   get_args.space = space;
-   get_args.key = key;
-   get_args.buf_size = object_size_hint > 0 ? object_size_hint : STATE_DB_MAX_OBJECT_SIZE;
 
-   variable_blob object_buffer;
-   object_buffer.resize( get_args.buf_size );
-   get_args.buf = object_buffer.data();
-
-   statedb::get_object_result get_res;
-   state->get_next_object( get_res, get_args );
-
-   if( get_res.size > 0 )
-      object_buffer.resize( get_res.size );
-   else
-      object_buffer.clear();
-
-   return object_buffer;
+   return copy_object_value( state->get_next_shared_object( space, key ), object_size_hint );
 }
 
 THUNK_DEFINE( variable_blob, db_get_prev_object, ((const statedb::object_space&) space, (const statedb::object_key&) key, (int32_t) object_size_hint) )
@@ -500,39 +488,26 @@ THUNK_DEFINE( variable_blob, db_get_prev_object, ((const statedb::object_space&)
 
    auto state = context.get_state_node();
    KOINOS_ASSERT( state, state_node_not_found, "Current state node does not exist" );
-   statedb::get_object_args get_args;
-   get_args.space = space;
-   get_args.key = key;
-   get_args.buf_size = object_size_hint > 0 ? object_size_hint : STATE_DB_MAX_OBJECT_SIZE;
 
-   variable_blob object_buffer;
-   object_buffer.resize( get_args.buf_size );
-   get_args.buf = object_buffer.data();
-
-   statedb::get_object_result get_res;
-   state->get_prev_object( get_res, get_args );
-
-   if( get_res.size > 0 )
-      object_buffer.resize( get_res.size );
-   else
-      object_buffer.clear();
-
-   return object_buffer;
+   return copy_object_value( state->get_prev_shared_object( space, key ), object_size_hint );
 }
 
 THUNK_DEFINE( variable_blob, execute_contract, ((const contract_id_type&) contract_id, (uint32_t) entry_point, (const variable_blob&) args) )
 {
    uint256_t contract_key = pack::from_fixed_blob< uint160_t >( contract_id );
 
-   // We need to be in kernel mode to read the contract data
-   variable_blob bytecode;
-   with_privilege( context, privilege::kernel_mode, [&]()
-   {
-      bytecode = db_get_object( context, CONTRACT_SPACE_ID, contract_key );
-   });
+   auto state = context.get_state_node();
+   KOINOS_ASSERT( state, state_node_not_found, "Current state node does not exist" );
+
+   // The bytecode is shared with the database rather than copied, the
+   // backend only reads it
+   auto bytecode = state->get_shared_object( CONTRACT_SPACE_ID, contract_key ).value;
+   if( !bytecode )
+      bytecode = std::make_shared< const statedb::object_value >();
+
    wasm_allocator_type wa;
 
-   wasm_code_ptr bytecode_ptr( (uint8_t*)bytecode.data(), bytecode.size() );
+   wasm_code_ptr bytecode_ptr( (uint8_t*)bytecode->data(), bytecode->size() );
    backend_type backend( bytecode_ptr, bytecode_ptr.bounds(), registrar_type{} );
 
    backend.set_wasm_allocator( &wa );
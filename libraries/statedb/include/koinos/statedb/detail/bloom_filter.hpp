@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace koinos::statedb::detail {
+
+   // The splitmix64 finalizer, used to spread the bits of a hash before it is
+   // split in to probes.
+   inline uint64_t mix_hash( uint64_t h )
+   {
+      h ^= h >> 30;
+      h *= 0xbf58476d1ce4e5b9ull;
+      h ^= h >> 27;
+      h *= 0x94d049bb133111ebull;
+      h ^= h >> 31;
+      return h;
+   }
+
+   inline uint64_t hash_combine( uint64_t seed, uint64_t v )
+   {
+      return mix_hash( seed ^ ( v + 0x9e3779b97f4a7c15ull + ( seed << 6 ) + ( seed >> 2 ) ) );
+   }
+
+   /**
+    * A fixed size Bloom filter over 64 bit hashes.
+    *
+    * Probe positions are derived from the two halves of the hash by double
+    * hashing, so inserted hashes need to be well mixed. With the default ten
+    * bits per item, the false positive rate is just under one percent.
+    */
+   class bloom_filter
+   {
+      public:
+         bloom_filter( std::size_t items, std::size_t bits_per_item = 10 ) :
+            _bits( ( std::max< std::size_t >( items * bits_per_item, 64 ) + 63 ) / 64 ),
+            _bit_count( _bits.size() * 64 ),
+            _probes( std::clamp< uint32_t >( uint32_t( bits_per_item * 69 / 100 ), 1, 16 ) )
+         {}
+
+         void insert( uint64_t hash )
+         {
+            uint64_t h = hash;
+            const uint64_t delta = ( hash >> 32 ) | ( hash << 32 ) | 1;
+
+            for( uint32_t i = 0; i < _probes; ++i, h += delta )
+            {
+               const uint64_t bit = h % _bit_count;
+               _bits[ bit / 64 ] |= uint64_t( 1 ) << ( bit % 64 );
+            }
+         }
+
+         bool may_contain( uint64_t hash ) const
+         {
+            uint64_t h = hash;
+            const uint64_t delta = ( hash >> 32 ) | ( hash << 32 ) | 1;
+
+            for( uint32_t i = 0; i < _probes; ++i, h += delta )
+            {
+               const uint64_t bit = h % _bit_count;
+               if( !( _bits[ bit / 64 ] & ( uint64_t( 1 ) << ( bit % 64 ) ) ) )
+                  return false;
+            }
+
+            return true;
+         }
+
+      private:
+         std::vector< uint64_t > _bits;
+         uint64_t                _bit_count;
+         uint32_t                _probes;
+   };
+
+   /**
+    * Describes how a state delta filters lookups of values of type Value.
+    *
+    * A specialization with enabled set to true names the index whose lookups
+    * are filtered in index_tag and provides hash functions for both a value
+    * and a compatible key of that index. The hash of a value and of its key
+    * must be equal.
+    */
+   template< typename Value >
+   struct delta_key_filter
+   {
+      static constexpr bool enabled = false;
+      typedef void index_tag;
+   };
+
+   template< typename IdType >
+   inline uint64_t hash_id( const IdType& id )
+   {
+      return mix_hash( std::hash< IdType >()( id ) );
+   }
+
+} // koinos::statedb::detail
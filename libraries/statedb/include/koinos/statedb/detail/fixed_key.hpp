@@ -0,0 +1,81 @@
+#pragma once
+
+#include <koinos/statedb/statedb_types.hpp>
+#include <koinos/pack/rt/reflect.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+namespace koinos::statedb::detail {
+
+   /**
+    * A 256 bit key stored as 32 big endian bytes.
+    *
+    * Keys compare with memcmp, which orders them the same as the integers
+    * they hold, and serialize as their raw bytes, so the encoded keys sort
+    * bytewise too. Conversion to and from uint256_t only happens at the
+    * state_node interface.
+    */
+   struct fixed_key
+   {
+      static constexpr std::size_t size = 32;
+
+      fixed_blob< size > bytes = {};
+
+      fixed_key() = default;
+
+      explicit fixed_key( const uint256_t& v )
+      {
+         const auto& backend = v.backend();
+         const auto* limbs = backend.limbs();
+         constexpr std::size_t limb_bytes = sizeof( *limbs );
+
+         // Limbs are stored least significant first
+         for( std::size_t i = 0; i < backend.size(); ++i )
+         {
+            auto limb = limbs[ i ];
+            for( std::size_t j = 0; j < limb_bytes; ++j, limb >>= 8 )
+               bytes[ size - 1 - i * limb_bytes - j ] = char( limb & 0xff );
+         }
+      }
+
+      uint256_t to_uint256() const
+      {
+         uint256_t v;
+         const auto* first = reinterpret_cast< const uint8_t* >( bytes.data() );
+         boost::multiprecision::import_bits( v, first, first + size, 8, true );
+         return v;
+      }
+
+      int compare( const fixed_key& other ) const
+      {
+         return std::memcmp( bytes.data(), other.bytes.data(), size );
+      }
+
+      // Loads the i-th 64 bit word in native byte order, for hashing
+      uint64_t word( std::size_t i ) const
+      {
+         uint64_t w;
+         std::memcpy( &w, bytes.data() + i * sizeof( w ), sizeof( w ) );
+         return w;
+      }
+   };
+
+   inline bool operator <( const fixed_key& a, const fixed_key& b )
+   {
+      return a.compare( b ) < 0;
+   }
+
+   inline bool operator ==( const fixed_key& a, const fixed_key& b )
+   {
+      return a.compare( b ) == 0;
+   }
+
+   inline bool operator !=( const fixed_key& a, const fixed_key& b )
+   {
+      return a.compare( b ) != 0;
+   }
+
+} // koinos::statedb::detail
+
+KOINOS_REFLECT( koinos::statedb::detail::fixed_key, (bytes) )
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <koinos/statedb/detail/bloom_filter.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace koinos::statedb::detail {
+
+   /**
+    * An insert only open addressing hash set of object ids.
+    *
+    * State deltas record every object they modify or remove. A sorted set
+    * makes each insert shift the ids after it, which turns quadratic for
+    * blocks touching tens of thousands of objects. Here inserts and lookups
+    * are a linear probe in a power of two table kept at most half full.
+    *
+    * Iteration order is unspecified.
+    */
+   template< typename IdType >
+   class id_set
+   {
+      private:
+         std::vector< IdType >   _slots;
+         std::vector< bool >     _used;
+         std::size_t             _size = 0;
+         std::size_t             _mask = 0;
+
+         std::size_t slot_of( const IdType& id ) const
+         {
+            std::size_t slot = std::size_t( hash_id( id ) ) & _mask;
+
+            while( _used[ slot ] && !( _slots[ slot ] == id ) )
+               slot = ( slot + 1 ) & _mask;
+
+            return slot;
+         }
+
+         void rehash( std::size_t capacity )
+         {
+            std::vector< IdType > slots( capacity );
+            std::vector< bool > used( capacity, false );
+            std::swap( _slots, slots );
+            std::swap( _used, used );
+            _mask = capacity - 1;
+
+            for( std::size_t i = 0; i < used.size(); ++i )
+            {
+               if( used[ i ] )
+               {
+                  auto slot = slot_of( slots[ i ] );
+                  _slots[ slot ] = std::move( slots[ i ] );
+                  _used[ slot ] = true;
+               }
+            }
+         }
+
+      public:
+         class const_iterator
+         {
+            public:
+               typedef std::forward_iterator_tag   iterator_category;
+               typedef IdType                      value_type;
+               typedef std::ptrdiff_t              difference_type;
+               typedef const IdType*               pointer;
+               typedef const IdType&               reference;
+
+               const_iterator() = default;
+
+               reference operator*() const { return _set->_slots[ _slot ]; }
+               pointer operator->() const { return &_set->_slots[ _slot ]; }
+
+               const_iterator& operator++()
+               {
+                  ++_slot;
+                  skip_unused();
+                  return *this;
+               }
+
+               const_iterator operator++( int )
+               {
+                  auto tmp = *this;
+                  ++( *this );
+                  return tmp;
+               }
+
+               bool operator==( const const_iterator& other ) const { return _slot == other._slot; }
+               bool operator!=( const const_iterator& other ) const { return _slot != other._slot; }
+
+            private:
+               friend class id_set;
+
+               const_iterator( const id_set* set, std::size_t slot ) : _set( set ), _slot( slot )
+               {
+                  skip_unused();
+               }
+
+               void skip_unused()
+               {
+                  while( _slot < _set->_used.size() && !_set->_used[ _slot ] )
+                     ++_slot;
+               }
+
+               const id_set*  _set = nullptr;
+               std::size_t    _slot = 0;
+         };
+
+         typedef const_iterator iterator;
+
+         id_set() = default;
+
+         /**
+          * Returns true if the id was not already in the set.
+          */
+         bool insert( const IdType& id )
+         {
+            if( 2 * ( _size + 1 ) > _slots.size() )
+               rehash( std::max< std::size_t >( 2 * _slots.size(), 16 ) );
+
+            auto slot = slot_of( id );
+            if( _used[ slot ] )
+               return false;
+
+            _slots[ slot ] = id;
+            _used[ slot ] = true;
+            ++_size;
+            return true;
+         }
+
+         template< typename InputIterator >
+         void insert( InputIterator first, InputIterator last )
+         {
+            for( ; first != last; ++first )
+               insert( *first );
+         }
+
+         bool contains( const IdType& id ) const
+         {
+            return _size && _used[ slot_of( id ) ];
+         }
+
+         void reserve( std::size_t n )
+         {
+            std::size_t capacity = 16;
+            while( capacity < 2 * n )
+               capacity *= 2;
+
+            if( capacity > _slots.size() )
+               rehash( capacity );
+         }
+
+         void clear()
+         {
+            _slots.clear();
+            _used.clear();
+            _size = 0;
+            _mask = 0;
+         }
+
+         std::size_t size() const { return _size; }
+         bool empty() const { return !_size; }
+
+         const_iterator begin() const { return const_iterator( this, 0 ); }
+         const_iterator end() const { return const_iterator( this, _used.size() ); }
+   };
+
+} // koinos::statedb::detail
@@ -2,20 +2,27 @@
 
 #include <koinos/statedb/detail/state_delta.hpp>
 
-#include <boost/container/deque.hpp>
+#include <boost/operators.hpp>
 
-#include <boost/iterator/zip_iterator.hpp>
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
+#include <memory>
+#include <vector>
 
 namespace koinos::statedb::detail {
 
-   using namespace boost::multi_index;
-
+   /**
+    * A k-way merge of the indices in a chain of state deltas.
+    *
+    * Each delta with objects contributes a cursor in to its own index. Cursors
+    * that are not exhausted are kept in a small binary heap ordered by the
+    * index's value order in the current direction of travel, with ties going
+    * to the newer delta. A value whose object was modified or removed in a
+    * newer delta is shadowed and is skipped when its cursor reaches the top.
+    *
+    * The set of deltas that can shadow a value is collected once at
+    * construction and shared between copies of the iterator. Changing
+    * direction seeks every cursor relative to the current value and rebuilds
+    * the heap.
+    */
    template< typename MultiIndexType, typename IndexedByType >
    class merge_iterator :
       public boost::bidirectional_iterator_helper<
@@ -30,178 +37,92 @@ namespace koinos::statedb::detail {
       private:
          typedef decltype( ((MultiIndexType*)nullptr)->template get< IndexedByType >() )  by_index_type;
          typedef typename by_index_type::iter_type                                        iter_type;
-         typedef typename by_index_type::bmic_type::key_type                              key_type;
-         typedef typename by_index_type::bmic_type::key_from_value                        key_from_value_type;
-         typedef typename by_index_type::bmic_type::key_compare                           key_compare_type;
          typedef typename by_index_type::bmic_type::value_compare                         value_compare_type;
          typedef state_delta< MultiIndexType >                                            state_delta_type;
          typedef std::shared_ptr< state_delta_type >                                      state_delta_ptr;
 
-         struct iterator_wrapper
+         struct merge_state
          {
-            iterator_wrapper( iter_type&& i, uint64_t r, const std::shared_ptr< MultiIndexType > idx ) :
-               iter( std::move( i ) ),
-               revision( r ),
-               index( idx )
-            {}
-
-            iterator_wrapper( iterator_wrapper&& i ) :
-               iter( std::move( i.iter ) ),
-               revision( i.revision ),
-               index( i.index )
-            {}
-
-            iterator_wrapper( const iterator_wrapper& i ) :
-               iter( i.iter ),
-               revision( i.revision ),
-               index( i.index )
-            {}
-
-            iter_type                                 iter;
-            uint64_t                                  revision;
-            const std::shared_ptr< MultiIndexType >   index;
-
-            const iterator_wrapper& self() const { return *this; }
-            bool valid() const { return iter != index->template get< IndexedByType >().end(); }
-         };
+            // Holding the deltas and their indices keeps every cursor valid for
+            // the lifetime of the iterator, even if the deltas are committed.
+            std::vector< state_delta_ptr >                     deltas;
+            std::vector< std::shared_ptr< MultiIndexType > >   indices;
 
-         // Uses revision as a tiebreaker only for when both iterators are invalid
-         // to enforce a total ordering on this comparator. The composite key on
-         // revision is still needed for the case when iterators are valid and equal.
-         // (i.e. lhs < rhs == false && rhs < lhs == false )
-         struct iterator_compare_less
-         {
-            bool operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs )const
-            {
-               bool lh_valid = lhs.valid();
-               bool rh_valid = rhs.valid();
-
-               if( !lh_valid && !rh_valid ) return lhs.revision > rhs.revision;
-               if( !lh_valid ) return false;
-               if( !rh_valid ) return true;
-
-               // Indirection is normally a const method. However, because the rocksdb_iterator may
-               // need to go to cache, internal state is updated and the operator is not const.
-               // The value returned is always the same, even if internal state is updated, so this is safe.
-               return value_compare_type()( *const_cast< iter_type& >(lhs.iter),
-                                       *const_cast< iter_type& >(rhs.iter) );
-            }
+            // Deltas with modified or removed objects, newest first
+            std::vector< const state_delta_type* >             shadows;
          };
 
-         struct iterator_compare_greater
+         struct cursor
          {
-            bool operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs )const
-            {
-               bool lh_valid = lhs.valid();
-               bool rh_valid = rhs.valid();
+            const MultiIndexType*   index;
+            iter_type               iter;
+            uint64_t                revision;
+            uint32_t                owner;      // Position of the cursor's delta in merge_state
 
-               if( !lh_valid && !rh_valid ) return lhs.revision > rhs.revision;
-               if( !lh_valid ) return false;
-               if( !rh_valid ) return true;
-
-               return value_compare_type()( *const_cast< iter_type& >(rhs.iter),
-                                       *const_cast< iter_type& >(lhs.iter) );
-            }
+            by_index_type by_index() const { return index->template get< IndexedByType >(); }
+            bool valid() const { return iter != by_index().end(); }
          };
 
-         struct by_order_revision;
-         struct by_reverse_order_revision;
-         struct by_revision;
-
-
-         typedef multi_index_container<
-            iterator_wrapper,
-            indexed_by<
-               ordered_unique< tag< by_order_revision >,
-                  composite_key< iterator_wrapper,
-                     const_mem_fun< iterator_wrapper, const iterator_wrapper&, &iterator_wrapper::self >,
-                     member< iterator_wrapper, uint64_t, &iterator_wrapper::revision >
-                  >,
-                  composite_key_compare< iterator_compare_less, std::greater< uint64_t > >
-               >,
-               ordered_unique< tag< by_reverse_order_revision >,
-                  composite_key< iterator_wrapper,
-                     const_mem_fun< iterator_wrapper, const iterator_wrapper&, &iterator_wrapper::self >,
-                     member< iterator_wrapper, uint64_t, &iterator_wrapper::revision >
-                  >,
-                  composite_key_compare< iterator_compare_greater, std::greater< uint64_t > >
-               >,
-               ordered_unique< tag< by_revision >, member< iterator_wrapper, uint64_t, &iterator_wrapper::revision > >
-            >
-         > iter_revision_index_type;
-
-         iter_revision_index_type                     _iter_rev_index;
-         boost::container::deque< state_delta_ptr >   _delta_deque;
+         std::shared_ptr< const merge_state >   _state;
+         std::vector< cursor >                  _cursors;
+         std::vector< uint32_t >                _heap;      // Cursors that are not exhausted
+         bool                                   _forward = true;
 
       public:
          template< typename Initializer >
          merge_iterator( state_delta_ptr head, Initializer&& init )
          {
             KOINOS_ASSERT( head, internal_error, "Cannot create a merge iterator on an null delta." );
-            auto current_delta = head;
 
-            do
-            {
-               _delta_deque.push_front( current_delta );
+            auto state = std::make_shared< merge_state >();
 
-               const auto& by_index = current_delta->indices()->template get< IndexedByType >();
-               iterator_wrapper undo_itr(
-                  std::move( init( by_index ) ),
-                  current_delta->revision(),
-                  current_delta->indices() );
+            for( auto current_delta = head; current_delta; current_delta = current_delta->parent() )
+            {
+               const auto& indices = current_delta->indices();
 
-               _iter_rev_index.emplace( std::move( undo_itr ) );
+               state->deltas.push_back( current_delta );
+               state->indices.push_back( indices );
 
-               current_delta = current_delta->parent();
-            } while( current_delta );
+               if( current_delta->has_modified_objects() )
+                  state->shadows.push_back( current_delta.get() );
 
-            resolve_conflicts();
-         }
+               // A delta with no objects cannot contribute a value to the merge
+               if( !current_delta->is_root() && !indices->size() )
+                  continue;
 
-         merge_iterator( const boost::container::deque< state_delta_ptr >& deque ) :
-            _delta_deque( deque )
-         {}
-
-         merge_iterator( const merge_iterator& other ) :
-            _iter_rev_index( other._iter_rev_index ),
-            _delta_deque( other._delta_deque )
-         {}
+               const auto by_index = indices->template get< IndexedByType >();
+               _cursors.push_back( cursor{ indices.get(), init( by_index ), current_delta->revision(), uint32_t( state->deltas.size() - 1 ) } );
+            }
 
-         merge_iterator( merge_iterator&& other ) :
-            _iter_rev_index( std::move( other._iter_rev_index ) ),
-            _delta_deque( other._delta_deque )
-         {}
+            _state = std::move( state );
+            make_heap();
+            skip_shadowed();
+         }
 
          merge_iterator() {}
 
          bool operator ==( const merge_iterator& other )const
          {
-            // If both iterators are empty, they are true.
-            // But we use empty merge iterators as an optimization for an end itertor.
-            // So if one is empty, and the other is all end iterators, they are also equal.
-            if( _iter_rev_index.size() == 0 && other._iter_rev_index.size() == 0 ) return true;
-            else if( _iter_rev_index.size() == 0 ) return other.is_end();
-            else if( other._iter_rev_index.size() == 0 ) return is_end();
-
-            auto my_begin = _iter_rev_index.begin();
-            auto other_begin = other._iter_rev_index.begin();
+            // A default constructed merge iterator is used as an end iterator.
+            // It is equal to any iterator that has exhausted all of its cursors.
+            if( _heap.empty() || other._heap.empty() )
+               return _heap.empty() && other._heap.empty();
 
-            if( !my_begin->valid() && !other_begin->valid() ) return true;
-            if( !my_begin->valid() || !other_begin->valid() ) return false;
-            if( my_begin->revision != other_begin->revision ) return false;
+            const auto& lhs = top();
+            const auto& rhs = other.top();
 
-            return my_begin->iter == other_begin->iter;
+            return lhs.revision == rhs.revision && lhs.iter == rhs.iter;
          }
 
          merge_iterator& operator ++()
          {
-            auto first_itr = _iter_rev_index.begin();
+            if( _heap.empty() )
+               return *this;
 
-            if( first_itr->valid() )
-            {
-               _iter_rev_index.modify( first_itr, []( iterator_wrapper& i ){ ++(i.iter); } );
-               resolve_conflicts();
-            }
+            if( !_forward )
+               seek( true );
+
+            advance();
 
             return *this;
          }
@@ -213,103 +134,29 @@ namespace koinos::statedb::detail {
 
          merge_iterator& operator --()
          {
-            const auto& order_idx = _iter_rev_index.template get< by_order_revision >();
-
-            auto head_itr = order_idx.begin();
-            // composite keys do not have default initializers, so we need to store them as a pointer
-            std::unique_ptr< key_type > head_key;
-
-            key_from_value_type key_from_value;
-            key_compare_type    key_compare;
-
-            if( head_itr->valid() )
+            if( _heap.empty() )
             {
-               head_key = std::make_unique< key_type >( key_from_value( *(head_itr->iter) ) );
-            }
+               // Past the end, bring every cursor back to its last value
+               _forward = false;
 
-            /* We are grabbing the current head value.
-             * Then iterate over all other iterators and rewind them until they have a value less
-             * than the current value. One of those values is what we want to decrement to.
-             */
-            const auto& rev_idx = _iter_rev_index.template get< by_revision >();
-            for( auto rev_itr = rev_idx.begin(); rev_itr != rev_idx.end(); ++rev_itr )
-            {
-               // Only decrement iterators that have modified objects
-               if( rev_itr->index->size() )
+               for( auto& c : _cursors )
                {
-                  auto begin = rev_itr->index->template get< IndexedByType >().begin();
-
-                  if( !head_key )
-                  {
-                     // If there was no valid key, then bring back each iterator once, it is gauranteed to be less than the
-                     // current value (end()).
-                     _iter_rev_index.modify( _iter_rev_index.iterator_to( *rev_itr ), [&]( iterator_wrapper& i ){ --(i.iter); } );
-                  }
-                  else
-                  {
-                     // Do an initial decrement if the iterator currently points to end()
-                     if( !rev_itr->valid() )
-                     {
-                        _iter_rev_index.modify( _iter_rev_index.iterator_to( *rev_itr ), [&]( iterator_wrapper& i ){ --(i.iter); } );
-                     }
-
-                     // Decrement back to the first key that is less than the head key
-                     while( !key_compare( key_from_value( *(rev_itr->iter) ), *head_key ) && rev_itr->iter != begin )
-                     {
-                        _iter_rev_index.modify( _iter_rev_index.iterator_to( *rev_itr ), [&]( iterator_wrapper& i ){ --(i.iter); } );
-                     }
-                  }
-
-                  // The key at this point is guaranteed to be less than the head key (or at begin() and greator), but it
-                  // might have been modified in a later index. We need to continue decrementing until we have a valid key.
-                  bool dirty = true;
-
-                  while( dirty && rev_itr->valid() && rev_itr->iter != begin )
-                  {
-                     dirty = is_dirty( rev_itr );
-
-                     if( dirty )
-                     {
-                        _iter_rev_index.modify( _iter_rev_index.iterator_to( *(rev_itr) ), [](iterator_wrapper& i ){ --(i.iter); } );
-                     }
-                  }
+                  c.iter = c.by_index().end();
+                  step( c );
                }
-            }
-
-            const auto& rev_order_idx = _iter_rev_index.template get< by_reverse_order_revision >();
-            auto least_itr = rev_order_idx.begin();
 
-            if( _delta_deque.size() > 1 )
+               make_heap();
+               skip_shadowed();
+            }
+            else if( _forward )
             {
-               // This next bit works in two modes.
-               // Some indices may not have had a value less than the previous head, so they will show up first,
-               // we need to increment through those values until we get the the new valid least value.
-               if( head_key )
-               {
-                  while( least_itr != rev_order_idx.end() && least_itr->valid()
-                     && ( is_dirty( least_itr ) || !key_compare( key_from_value( *(least_itr->iter) ), *head_key ) ) )
-                  {
-                     ++least_itr;
-                  }
-               }
-
-               // Now least_itr points to the new least value, unless it is end()
-               if( least_itr != rev_order_idx.end() )
-               {
-                  ++least_itr;
-               }
-
-               // Now least_itr points to the next value. All of these are too much less, but are guaranteed to be valid.
-               // All values in this indices one past are gauranteed to be greater than the new least, or invalid by
-               // modification. We can increment all of them once, and then call resolve_conflicts for the new least value
-               // to become the head.
-               while( least_itr != rev_order_idx.end() && least_itr->valid() )
-               {
-                  _iter_rev_index.modify( _iter_rev_index.iterator_to( *(least_itr--) ), [](iterator_wrapper& i ){ ++(i.iter); } );
-                  ++least_itr;
-               }
-
-               resolve_conflicts();
+               // Seeking backwards positions every cursor before the current
+               // value, so the new top is already the previous value.
+               seek( false );
+            }
+            else
+            {
+               advance();
             }
 
             return *this;
@@ -322,74 +169,187 @@ namespace koinos::statedb::detail {
 
          const value_type& operator*()const
          {
-            return _iter_rev_index.begin()->iter.operator *();
+            return *(top().iter);
          }
 
          const value_type* operator->()const
          {
-            return _iter_rev_index.begin()->iter.operator ->();
+            return top().iter.operator ->();
          }
 
-         merge_iterator& operator =( const merge_iterator& other )
+         /**
+          * The current value, shared with the delta holding it, or with root's
+          * object cache, rather than referenced. Values in a delta that may
+          * still change are copied, see state_delta::shares_objects().
+          */
+         std::shared_ptr< const value_type > shared()const
          {
-            KOINOS_ASSERT( _delta_deque.size(), internal_error, "Merge iterator is unexpectedly empty" );
-            KOINOS_ASSERT( _delta_deque.size() == other._delta_deque.size(), internal_error, "Cannot assign iterators with different delta deques." );
-            KOINOS_ASSERT( _delta_deque.begin()->id() == _delta_deque.begin()->id(), internal_error, "Cannot assign merge iterators with different roots" );
-            KOINOS_ASSERT( _delta_deque.rbegin()->id() == _delta_deque.rbegin()->id(), internal_error, "Cannot assign merge iterators with different heads" );
+            const auto& c = top();
+            const auto& delta = _state->deltas[ c.owner ];
 
-            _iter_rev_index = other._iter_rev_index;
+            if( delta->shares_objects() )
+            {
+               if( !delta->is_root() )
+                  return std::shared_ptr< const value_type >( _state->indices[ c.owner ], &*(c.iter) );
 
-            return *this;
+               if( auto shared = c.iter.shared() )
+                  return shared;
+            }
+
+            return std::make_shared< const value_type >( *(c.iter) );
          }
 
-         merge_iterator& operator =( merge_iterator&& other )
+      private:
+         const cursor& top() const
          {
-            KOINOS_ASSERT( _delta_deque.size(), internal_error, "Merge iterator is unexpectedly empty" );
-            KOINOS_ASSERT( _delta_deque.size() == other._delta_deque.size(), internal_error, "Cannot assign iterators with different delta deques." );
-            KOINOS_ASSERT( _delta_deque.begin()->id() == _delta_deque.begin()->id(), internal_error, "Cannot assign merge iterators with different roots" );
-            KOINOS_ASSERT( _delta_deque.rbegin()->id() == _delta_deque.rbegin()->id(), internal_error, "Cannot assign merge iterators with different heads" );
+            return _cursors[ _heap.front() ];
+         }
 
-            _iter_rev_index = std::move( other._iter_rev_index );
+         cursor& top()
+         {
+            return _cursors[ _heap.front() ];
+         }
 
-            return *this;
+         /*
+          * Returns true if the lhs cursor is visited before the rhs cursor in
+          * the current direction. Both cursors must be valid.
+          */
+         bool precedes( const cursor& lhs, const cursor& rhs ) const
+         {
+            value_compare_type compare;
+            const auto& lhs_value = *(lhs.iter);
+            const auto& rhs_value = *(rhs.iter);
+
+            if( _forward ? compare( lhs_value, rhs_value ) : compare( rhs_value, lhs_value ) ) return true;
+            if( _forward ? compare( rhs_value, lhs_value ) : compare( lhs_value, rhs_value ) ) return false;
+
+            return lhs.revision > rhs.revision;
          }
 
-      private:
-         template< typename IterType >
-         bool is_dirty( IterType itr )
+         void sift_down( size_t pos )
+         {
+            const size_t size = _heap.size();
+
+            while( true )
+            {
+               size_t first = pos;
+               size_t left = 2 * pos + 1;
+               size_t right = left + 1;
+
+               if( left < size && precedes( _cursors[ _heap[ left ] ], _cursors[ _heap[ first ] ] ) )
+                  first = left;
+               if( right < size && precedes( _cursors[ _heap[ right ] ], _cursors[ _heap[ first ] ] ) )
+                  first = right;
+
+               if( first == pos )
+                  return;
+
+               std::swap( _heap[ pos ], _heap[ first ] );
+               pos = first;
+            }
+         }
+
+         void make_heap()
          {
-            bool dirty = false;
+            _heap.clear();
 
-            for( int i = _delta_deque.size() - 1; itr->revision < _delta_deque[i]->revision() && !dirty; --i )
+            for( uint32_t i = 0; i < _cursors.size(); ++i )
             {
-               dirty = _delta_deque[i]->is_modified( itr->iter->id );
+               if( _cursors[ i ].valid() )
+                  _heap.push_back( i );
             }
 
-            return dirty;
+            for( size_t i = _heap.size() / 2; i > 0; --i )
+               sift_down( i - 1 );
          }
 
-         void resolve_conflicts()
+         // Moves a cursor one value in the current direction. A cursor that
+         // steps back from its first value is exhausted and points to end().
+         void step( cursor& c )
          {
-            auto first_itr = _iter_rev_index.begin();
-            bool dirty = true;
+            if( _forward )
+            {
+               ++(c.iter);
+            }
+            else
+            {
+               auto by_index = c.by_index();
+
+               if( c.iter == by_index.begin() )
+                  c.iter = by_index.end();
+               else
+                  --(c.iter);
+            }
+         }
 
-            while( dirty && first_itr->valid() )
+         void step_top()
+         {
+            step( top() );
+
+            if( !top().valid() )
             {
-               dirty = is_dirty( first_itr );
+               _heap.front() = _heap.back();
+               _heap.pop_back();
+            }
 
-               if( dirty )
-               {
-                  _iter_rev_index.modify( first_itr, [](iterator_wrapper& i ){ ++(i.iter); } );
-               }
+            if( _heap.size() )
+               sift_down( 0 );
+         }
 
-               first_itr = _iter_rev_index.begin();
+         void advance()
+         {
+            step_top();
+            skip_shadowed();
+         }
+
+         bool is_shadowed( const cursor& c ) const
+         {
+            const auto& id = c.iter->id;
+
+            for( const auto* delta : _state->shadows )
+            {
+               if( delta->revision() <= c.revision )
+                  break;
+
+               if( delta->is_modified( id ) )
+                  return true;
             }
+
+            return false;
+         }
+
+         void skip_shadowed()
+         {
+            while( _heap.size() && is_shadowed( top() ) )
+               step_top();
          }
 
-         bool is_end() const
+         /*
+          * Changes direction around the current value.
+          *
+          * Forward, every cursor is positioned at its first value not less than
+          * the current value, which leaves the current value on top. Backward,
+          * every cursor is positioned at its last value less than the current
+          * value.
+          */
+         void seek( bool forward )
          {
-            return std::all_of( _iter_rev_index.begin(), _iter_rev_index.end(),
-               []( auto& i ){ return !i.valid(); } );
+            // The cursor holding the current value is about to move
+            const value_type current = *(top().iter);
+
+            _forward = forward;
+
+            for( auto& c : _cursors )
+            {
+               auto by_index = c.by_index();
+               c.iter = by_index.lower_bound( current );
+
+               if( !_forward )
+                  step( c );
+            }
+
+            make_heap();
+            skip_shadowed();
          }
    };
 
@@ -427,6 +387,19 @@ namespace koinos::statedb::detail {
             });
          }
 
+         /*
+          * Like upper_bound, but the root index only reads keys sharing the
+          * key prefix of key. Only meant to be incremented.
+          */
+         template< typename CompatibleKey >
+         iterator_type upper_bound_in_prefix( CompatibleKey&& key ) const
+         {
+            return iterator_type( _head, [&]( by_index_type& idx )
+            {
+               return idx.upper_bound_in_prefix( key );
+            });
+         }
+
          template< typename CompatibleKey >
          std::pair< iterator_type, iterator_type > equal_range( CompatibleKey&& key ) const
          {
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <koinos/statedb/statedb_types.hpp>
+#include <koinos/statedb/detail/bloom_filter.hpp>
+#include <koinos/statedb/detail/fixed_key.hpp>
+#include <koinos/statedb/detail/persistent_map.hpp>
 #include <koinos/pack/rt/reflect.hpp>
 #include <koinos/pack/rt/binary_serializer.hpp>
 
@@ -9,40 +12,122 @@
 #include <mira/tag.hpp>
 #include <mira/member.hpp>
 #include <mira/indexed_by.hpp>
-#include <mira/composite_key.hpp>
 
 namespace koinos::statedb::detail {
 
-struct state_object
+/**
+ * The address of an object in state.
+ *
+ * Objects are stored and looked up by their address directly, there is no
+ * surrogate id. Deltas track modified and removed objects by address too.
+ *
+ * Space and key are held as fixed_key, so comparing addresses is two memcmp
+ * calls rather than multiprecision arithmetic.
+ */
+struct state_record_id
 {
-   typedef uint64_t id_type;
+   state_record_id() = default;
+   state_record_id( const object_space& s, const object_key& k ) : space( s ), key( k ) {}
 
-   id_type           id = 0;
+   fixed_key         space;
+   fixed_key         key;
+};
+
+inline bool operator <( const state_record_id& a, const state_record_id& b )
+{
+   int c = a.space.compare( b.space );
+   return c ? c < 0 : a.key.compare( b.key ) < 0;
+}
+
+inline bool operator ==( const state_record_id& a, const state_record_id& b )
+{
+   return a.space == b.space && a.key == b.key;
+}
+
+inline bool operator !=( const state_record_id& a, const state_record_id& b )
+{
+   return !( a == b );
+}
 
-   object_space      space;
-   object_key        key;
+struct state_record
+{
+   typedef state_record_id id_type;
+
+   id_type           id;
    object_value      value;
 };
 
-struct by_id;
 struct by_key;
 
 typedef mira::multi_index_adapter<
-   state_object,
+   state_record,
    koinos::pack::binary_serializer,
    mira::multi_index::indexed_by<
-      mira::multi_index::ordered_unique< mira::multi_index::tag< by_id >,
-         mira::multi_index::member< state_object, state_object::id_type, &state_object::id > >,
       mira::multi_index::ordered_unique< mira::multi_index::tag< by_key >,
-         mira::multi_index::composite_key< state_object,
-            mira::multi_index::member< state_object, object_space, &state_object::space >,
-            mira::multi_index::member< state_object, object_key, &state_object::key >
-         >
-      >
+         mira::multi_index::member< state_record, state_record::id_type, &state_record::id > >
    >
-> state_object_index;
+> state_record_index;
+
+inline uint64_t hash_fixed_key( uint64_t seed, const fixed_key& k )
+{
+   for( std::size_t i = 0; i < fixed_key::size / sizeof( uint64_t ); ++i )
+      seed = hash_combine( seed, k.word( i ) );
+
+   return seed;
+}
+
+inline uint64_t hash_id( const state_record_id& id )
+{
+   return hash_fixed_key( hash_fixed_key( 0, id.space ), id.key );
+}
+
+template<>
+struct delta_key_filter< state_record >
+{
+   static constexpr bool enabled = true;
+   typedef by_key index_tag;
+
+   static uint64_t hash( const state_record_id& id )
+   {
+      return hash_id( id );
+   }
+
+   static uint64_t hash( const state_record& obj )
+   {
+      return hash_id( obj.id );
+   }
+};
+
+template<>
+struct delta_view< state_record >
+{
+   static constexpr bool enabled = true;
+   typedef by_key index_tag;
+};
 
 } // koinos::statedb::detail
 
-KOINOS_REFLECT( koinos::statedb::detail::state_object,
-             (id)(space)(key)(value) )
+namespace mira {
+
+// The value blob may hold more memory than it serializes to
+template<>
+struct object_charge< koinos::statedb::detail::state_record, koinos::pack::binary_serializer >
+{
+   static size_t charge( const koinos::statedb::detail::state_record& r )
+   {
+      return sizeof( r ) + r.value.capacity();
+   }
+};
+
+} // mira
+
+// Both fixed keys serialize as their big endian bytes, space first
+MIRA_BYTEWISE_ORDERED_KEY( koinos::statedb::detail::state_record_id, koinos::pack::binary_serializer )
+MIRA_KEY_PREFIX_LENGTH( koinos::statedb::detail::state_record_id, koinos::pack::binary_serializer,
+   koinos::statedb::detail::fixed_key::size )
+
+KOINOS_REFLECT( koinos::statedb::detail::state_record_id,
+             (space)(key) )
+
+KOINOS_REFLECT( koinos::statedb::detail::state_record,
+             (id)(value) )
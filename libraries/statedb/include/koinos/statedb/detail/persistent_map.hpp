@@ -0,0 +1,139 @@
+#pragma once
+
+#include <koinos/statedb/detail/bloom_filter.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace koinos::statedb::detail {
+
+   /**
+    * An ordered map whose copies share structure.
+    *
+    * The map is a treap of immutable nodes. Inserting copies the nodes on the
+    * path to the key and shares every other node with the map it was
+    * inserted in to, so copying a map is O(1) and a copy never sees inserts
+    * made to the original afterwards, or the other way around.
+    *
+    * Priorities are hashes of the keys, so the shape depends only on the keys
+    * held and lookups are O(log n) expected. Entries are never removed, state
+    * deltas record a removal as an entry with an empty value.
+    *
+    * Copies may be read from multiple threads. A single map must not be read
+    * while it is inserted in to.
+    */
+   template< typename Key, typename Value, typename Compare = std::less< Key > >
+   class persistent_map
+   {
+      private:
+         struct node;
+         typedef std::shared_ptr< const node > node_ptr;
+
+         struct node
+         {
+            node( const Key& k, const Value& v, uint64_t p, node_ptr l, node_ptr r ) :
+               key( k ), value( v ), priority( p ), left( std::move( l ) ), right( std::move( r ) ) {}
+
+            Key      key;
+            Value    value;
+            uint64_t priority;
+            node_ptr left;
+            node_ptr right;
+         };
+
+         node_ptr    _root;
+         std::size_t _size = 0;
+         Compare     _compare;
+
+         node_ptr insert( const node_ptr& n, const Key& k, const Value& v, uint64_t priority, bool& inserted ) const
+         {
+            if( !n )
+            {
+               inserted = true;
+               return std::make_shared< const node >( k, v, priority, nullptr, nullptr );
+            }
+
+            if( _compare( k, n->key ) )
+            {
+               auto left = insert( n->left, k, v, priority, inserted );
+
+               // Rotate right to keep the heap order on priorities
+               if( left->priority > n->priority )
+                  return std::make_shared< const node >( left->key, left->value, left->priority, left->left,
+                     std::make_shared< const node >( n->key, n->value, n->priority, left->right, n->right ) );
+
+               return std::make_shared< const node >( n->key, n->value, n->priority, std::move( left ), n->right );
+            }
+
+            if( _compare( n->key, k ) )
+            {
+               auto right = insert( n->right, k, v, priority, inserted );
+
+               if( right->priority > n->priority )
+                  return std::make_shared< const node >( right->key, right->value, right->priority,
+                     std::make_shared< const node >( n->key, n->value, n->priority, n->left, right->left ), right->right );
+
+               return std::make_shared< const node >( n->key, n->value, n->priority, n->left, std::move( right ) );
+            }
+
+            return std::make_shared< const node >( n->key, v, n->priority, n->left, n->right );
+         }
+
+      public:
+         /**
+          * Sets the value of k, adding k if it is not in the map.
+          */
+         void insert_or_assign( const Key& k, const Value& v )
+         {
+            bool inserted = false;
+            _root = insert( _root, k, v, hash_id( k ), inserted );
+            if( inserted ) ++_size;
+         }
+
+         /**
+          * Returns the value of k, or nullptr if k is not in the map. The
+          * pointer is valid as long as this map or a copy of it is.
+          */
+         const Value* find( const Key& k ) const
+         {
+            const node* n = _root.get();
+
+            while( n )
+            {
+               if( _compare( k, n->key ) )
+                  n = n->left.get();
+               else if( _compare( n->key, k ) )
+                  n = n->right.get();
+               else
+                  return &n->value;
+            }
+
+            return nullptr;
+         }
+
+         std::size_t size() const
+         {
+            return _size;
+         }
+
+         bool empty() const
+         {
+            return _size == 0;
+         }
+   };
+
+   /**
+    * Deltas of objects with a delta_view answer lookups on index_tag from a
+    * single persistent_map of every object in the chain back to root, see
+    * state_delta::finalize(). The index must be keyed on the object's id.
+    */
+   template< typename ValueType >
+   struct delta_view
+   {
+      static constexpr bool enabled = false;
+      typedef void index_tag;
+   };
+
+} // koinos::statedb::detail
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <koinos/statedb/statedb_types.hpp>
+#include <koinos/pack/rt/reflect.hpp>
+
+#include <vector>
+
+namespace koinos::statedb::detail {
+
+/*
+ * A snapshot is a stream of the form:
+ *
+ *    snapshot_header
+ *    ( snapshot_chunk_header, serialized std::vector< snapshot_record > )*
+ *    snapshot_chunk_header with record_count == 0
+ *    snapshot_footer
+ *
+ * Records are sorted by (space, key) across the whole stream. Each chunk
+ * carries a checksum of its serialized records so a corrupt or truncated
+ * file is detected before any of its data is imported.
+ */
+
+constexpr uint32_t snapshot_magic      = 0x4b534e50; // "KSNP"
+constexpr uint32_t snapshot_version    = 1;
+constexpr uint64_t snapshot_chunk_size = 4 << 20;    // Target serialized size of a chunk
+
+struct snapshot_header
+{
+   uint32_t       magic = snapshot_magic;
+   uint32_t       version = snapshot_version;
+   uint64_t       revision = 0;
+   state_node_id  id;
+};
+
+struct snapshot_record
+{
+   object_space   space;
+   object_key     key;
+   object_value   value;
+};
+
+struct snapshot_chunk_header
+{
+   uint64_t       record_count = 0;
+   uint64_t       size = 0;
+   multihash      checksum;
+};
+
+struct snapshot_footer
+{
+   uint64_t       record_count = 0;
+};
+
+} // koinos::statedb::detail
+
+KOINOS_REFLECT( koinos::statedb::detail::snapshot_header, (magic)(version)(revision)(id) )
+KOINOS_REFLECT( koinos::statedb::detail::snapshot_record, (space)(key)(value) )
+KOINOS_REFLECT( koinos::statedb::detail::snapshot_chunk_header, (record_count)(size)(checksum) )
+KOINOS_REFLECT( koinos::statedb::detail::snapshot_footer, (record_count) )
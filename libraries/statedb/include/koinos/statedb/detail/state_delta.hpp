@@ -1,5 +1,8 @@
 #pragma once
 #include <koinos/statedb/statedb_types.hpp>
+#include <koinos/statedb/detail/bloom_filter.hpp>
+#include <koinos/statedb/detail/id_set.hpp>
+#include <koinos/statedb/detail/persistent_map.hpp>
 #include <koinos/statedb/detail/uniqueness_validator.hpp>
 
 #include <koinos/crypto/multihash.hpp>
@@ -7,6 +10,8 @@
 #include <any>
 #include <filesystem>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 const std::vector< uint8_t > ID_KEY { 'D','E','L','T','A','_','I','D' };
 
@@ -22,23 +27,39 @@ namespace koinos::statedb::detail {
          typedef typename index_type::value_type   value_type;
          typedef typename value_type::id_type      id_type;
          typedef typename index_type::iter_type    iter_type;
+         typedef delta_key_filter< value_type >    key_filter_type;
+         typedef delta_view< value_type >          view_type;
+         typedef persistent_map< id_type, std::shared_ptr< const value_type > > view_map;
+
+         // Objects with an integer id are given the next id when created.
+         // Other objects are addressed by an id the caller sets.
+         static constexpr bool assigns_ids = std::is_integral_v< id_type >;
 
          std::shared_ptr< state_delta >            _parent;
+         state_node_id                             _parent_id;
 
          std::shared_ptr< index_type >             _indices;
-         flat_set< id_type >                       _removed_objects;
-         flat_set< id_type >                       _modified_objects;
-         id_type                                   _next_object_id = 0;
+         id_set< id_type >                         _removed_objects;
+         id_set< id_type >                         _modified_objects;
+         id_type                                   _next_object_id{};
 
          state_node_id                             _id;
          uint64_t                                  _revision = 0;
 
+         // Built when the delta is finalized, see finalize()
+         std::unique_ptr< bloom_filter >           _key_filter;
+         std::unique_ptr< bloom_filter >           _id_filter;
+         std::unique_ptr< view_map >               _view;
+         std::shared_ptr< index_type >             _root_indices;
+         uint64_t                                  _view_base = 0;
+
       public:
          state_delta( std::shared_ptr< state_delta > parent, const state_node_id& id ) :
             _parent( parent ), _id( id )
          {
             if( _parent != nullptr )
             {
+               _parent_id = _parent->_id;
                _revision = _parent->_revision + 1;
                _next_object_id = _parent->_next_object_id;
             }
@@ -50,7 +71,8 @@ namespace koinos::statedb::detail {
          {
             _indices = std::make_shared< index_type >( index_type::type_enum::mira );
             _indices->open( p, o );
-            _next_object_id = _indices->next_id();
+            if constexpr( assigns_ids )
+               _next_object_id = _indices->next_id();
             _revision = _indices->revision();
             if( !_indices->get_metadata( ID_KEY, _id ) )
             {
@@ -62,37 +84,39 @@ namespace koinos::statedb::detail {
          template< typename Constructor >
          const std::pair< iter_type, bool > emplace( Constructor&& c )
          {
-            auto constructor = [&]( value_type& v )
-            {
-               v.id = _next_object_id;
-               c( v );
-            };
-
             value_type new_obj;
-
-            constructor( new_obj );
-            flat_set< id_type > ids;
+            if constexpr( assigns_ids )
+               new_obj.id = _next_object_id;
+            c( new_obj );
 
             if( !is_unique( new_obj ) )
                return std::make_pair( _indices->end(), false );
 
-            auto emplace_result = _indices->emplace( std::move( new_obj ) );
+            return insert_new( std::move( new_obj ) );
+         }
 
-            if( emplace_result.second )
-            {
-               ++_next_object_id;
+         /**
+          * Creates an object without checking the indices of every delta back
+          * to root for conflicts.
+          *
+          * The caller guarantees the object is unique, i.e. it has already
+          * searched for the object by every unique key other than id and not
+          * found it. Ids are assigned here and are always unique. Builds
+          * without NDEBUG still run the full check.
+          */
+         template< typename Constructor >
+         const std::pair< iter_type, bool > emplace_unique( Constructor&& c )
+         {
+            value_type new_obj;
+            if constexpr( assigns_ids )
+               new_obj.id = _next_object_id;
+            c( new_obj );
 
-               if( is_root() )
-               {
-                  _indices->set_next_id( _next_object_id );
-               }
-               else
-               {
-                  _modified_objects.insert( new_obj.id );
-               }
-            }
+#ifndef NDEBUG
+            KOINOS_ASSERT( is_unique( new_obj ), internal_error, "Object asserted unique conflicts with an existing object" );
+#endif
 
-            return emplace_result;
+            return insert_new( std::move( new_obj ) );
          }
 
          template< typename Modifier >
@@ -101,24 +125,33 @@ namespace koinos::statedb::detail {
             if( is_root() )
                return _indices->modify( _indices->iterator_to( obj ), m );
 
-            value_type mod_obj = obj;
-            m( mod_obj );
-            flat_set< id_type > ids;
-
             if( !is_unique( obj ) )
                return false;
 
-            if( _modified_objects.find( obj.id ) != _modified_objects.end() )
-            {
-               _indices->modify( _indices->iterator_to( obj ), m );
-            }
-            else
-            {
-               _indices->emplace( std::move( mod_obj ) );
-               _modified_objects.insert( obj.id );
-            }
+            return modify_existing( obj, m );
+         }
 
-            return true;
+         /**
+          * Modifies an object without checking the indices of every delta
+          * back to root for conflicts.
+          *
+          * The caller guarantees the modifier does not change any indexed
+          * member of the object, so the object stays unique. Builds without
+          * NDEBUG still run the full check.
+          */
+         template< typename Modifier >
+         bool modify_value( const value_type& obj, Modifier&& m )
+         {
+            if( is_root() )
+               return _indices->modify( _indices->iterator_to( obj ), m );
+
+#ifndef NDEBUG
+            value_type mod_obj = obj;
+            m( mod_obj );
+            KOINOS_ASSERT( is_unique( mod_obj ), internal_error, "Modified object conflicts with an existing object" );
+#endif
+
+            return modify_existing( obj, m );
          }
 
          /**
@@ -141,9 +174,17 @@ namespace koinos::statedb::detail {
          template< typename IndexedByType, typename CompatibleKey >
          const value_type* find( CompatibleKey& key )
          {
-            const auto& by_index = _indices->template get< IndexedByType >();
-            auto itr = by_index.find( key );
-            if( itr != by_index.end() ) return &*itr;
+            if constexpr( view_type::enabled && std::is_same_v< typename view_type::index_tag, IndexedByType > )
+            {
+               if( _view ) return find_in_view( key );
+            }
+
+            if( may_contain< IndexedByType >( key ) )
+            {
+               const auto& by_index = _indices->template get< IndexedByType >();
+               auto itr = by_index.find( key );
+               if( itr != by_index.end() ) return &*itr;
+            }
 
             const auto* ptr = is_root() ? nullptr : _parent->template find< IndexedByType >( key );
 
@@ -158,52 +199,50 @@ namespace koinos::statedb::detail {
             return find< IndexedByType >( key );
          }
 
-         void squash()
+         /**
+          * Like find(), but the object is shared with the delta holding it,
+          * or with root's object cache, rather than referenced. It stays valid
+          * once the deltas are committed or discarded.
+          *
+          * Objects in a delta that may still change are copied, see
+          * shares_objects().
+          */
+         template< typename IndexedByType, typename CompatibleKey >
+         std::shared_ptr< const value_type > find_shared( CompatibleKey& key )
          {
-            if( is_root() ) return;
-
-            for( id_type r_id : _removed_objects )
+            if constexpr( view_type::enabled && std::is_same_v< typename view_type::index_tag, IndexedByType > )
             {
-               auto r_itr = _parent->_indices->find( r_id );
-               if( r_itr != _parent->_indices->end() )
-               {
-                  _parent->_indices->erase( r_itr );
-               }
+               if( _view ) return find_shared_in_view( key );
             }
 
-            for( auto mod_itr = _indices->begin(); mod_itr != _indices->end(); ++mod_itr )
+            if( is_root() )
+               return find_shared_in_root< IndexedByType >( *_indices, key );
+
+            if( may_contain< IndexedByType >( key ) )
             {
-               auto itr = _parent->_indices->find( mod_itr->id );
-               if( itr == _parent->_indices->end() )
-               {
-                  value_type v = *mod_itr;
-                  _parent->_indices->emplace( std::move( v ) );
-               }
-               else
-               {
-                  _parent->_indices->modify( itr, [&]( value_type& v )
-                  {
-                     v = *mod_itr;
-                  });
-               }
+               const auto& by_index = _indices->template get< IndexedByType >();
+               auto itr = by_index.find( key );
+               if( itr != by_index.end() ) return std::make_shared< const value_type >( *itr );
             }
 
-            _parent->_next_object_id = _next_object_id;
+            auto ptr = _parent->template find_shared< IndexedByType >( key );
 
-            if( _parent->is_root() )
-            {
-               _parent->_indices->set_next_id( _next_object_id );
-            }
-            else
-            {
-               _parent->_removed_objects.merge( _removed_objects );
+            if( ptr != nullptr && is_removed( ptr->id ) ) return nullptr;
 
-               // There is a corner case where if an object is created in parent and
-               // modified here, then parent will show it as modified, when it is actually
-               // new. I do not believe this will cause problems, but it is worth noting
-               // it case it does.
-               _parent->_modified_objects.merge( _modified_objects );
-            }
+            return ptr;
+         }
+
+         template< typename IndexedByType, typename CompatibleKey >
+         std::shared_ptr< const value_type > find_shared( CompatibleKey&& key )
+         {
+            return find_shared< IndexedByType >( key );
+         }
+
+         void squash()
+         {
+            if( is_root() ) return;
+
+            apply_to( *_parent );
          }
 
          void squash( uint64_t revision )
@@ -215,6 +254,11 @@ namespace koinos::statedb::detail {
             }
          }
 
+         /**
+          * Squashes the delta in to every delta back to root, changing their
+          * objects in place. state_db commits with write_to_root() instead, so
+          * objects it has shared never change.
+          */
          void commit()
          {
             KOINOS_ASSERT( !is_root(), internal_error, "Cannot commit root." );
@@ -223,13 +267,174 @@ namespace koinos::statedb::detail {
 
             squash( 0 );
 
-            _indices = std::move( root->_indices );
-            _indices->set_next_id( _next_object_id );
+            // Deltas still parented on the old root keep reading its index
+            _indices = root->_indices;
+            KOINOS_ASSERT( _indices->flush_bulk_load(), internal_error, "Unable to write bulk loaded state" );
+            if constexpr( assigns_ids )
+               _indices->set_next_id( _next_object_id );
             _indices->set_revision( _revision );
             _indices->put_metadata( ID_KEY, _id );
             _modified_objects.clear();
             _removed_objects.clear();
             _parent.reset();
+            drop_filters();
+         }
+
+         /**
+          * Writes the contents of the chain of deltas from root to this delta
+          * to root's index in a single batch.
+          *
+          * No delta reads differently afterwards. Every object written or
+          * removed is shadowed by the chain, which stays in place until
+          * complete_commit() makes this delta root.
+          *
+          * Returns the ids written, for complete_commit().
+          */
+         std::vector< id_type > write_to_root()
+         {
+            KOINOS_ASSERT( !is_root(), internal_error, "Cannot commit root." );
+            auto flat = merge_chain();
+
+            std::vector< id_type > removed;
+            for( const auto& id : flat->_removed_objects )
+            {
+               if( flat->_indices->find( id ) == flat->_indices->end() )
+                  removed.push_back( id );
+            }
+
+            // Writes buffered by a bulk load must reach root before the batch
+            KOINOS_ASSERT( get_root()->_indices->flush_bulk_load(), internal_error, "Unable to write bulk loaded state" );
+            KOINOS_ASSERT( get_root()->_indices->write_batch( flat->_indices->begin(), flat->_indices->end(), removed ),
+               internal_error, "Unable to write committed state" );
+
+            std::vector< id_type > written = std::move( removed );
+            written.reserve( written.size() + flat->_indices->size() );
+            for( auto itr = flat->_indices->begin(); itr != flat->_indices->end(); ++itr )
+               written.push_back( itr->id );
+
+            return written;
+         }
+
+         /**
+          * Makes this delta root once write_to_root() has returned.
+          *
+          * The old root shares its index with this delta from then on, so
+          * deltas still parented on it read the committed state.
+          *
+          * Replaces the members readers of the chain use, so no reader or
+          * writer may use the delta meanwhile. The parent id never changes,
+          * the fork tree reads it without waiting.
+          */
+         void complete_commit( const std::vector< id_type >& written )
+         {
+            KOINOS_ASSERT( !is_root(), internal_error, "Cannot commit root." );
+            auto root = get_root();
+
+            root->_indices->invalidate( written );
+
+            _indices = root->_indices;
+            if constexpr( assigns_ids )
+               _indices->set_next_id( _next_object_id );
+            _indices->set_revision( _revision );
+            _indices->put_metadata( ID_KEY, _id );
+            _modified_objects.clear();
+            _removed_objects.clear();
+            _parent.reset();
+            drop_filters();
+         }
+
+         /**
+          * Creates a finalized delta with the same contents as the chain of
+          * deltas from root to this delta, parented directly on root.
+          *
+          * The chain is not modified. The new delta keeps this delta's id,
+          * revision and parent id, so it can replace this delta for readers.
+          */
+         std::shared_ptr< state_delta > flatten()
+         {
+            KOINOS_ASSERT( !is_root(), internal_error, "Cannot flatten root." );
+
+            auto flat = merge_chain();
+            flat->finalize();
+
+            return flat;
+         }
+
+         /**
+          * Moves the delta on to a new parent with the same contents as, or
+          * a subset of the contents of, the old parent. This happens when a
+          * flattened delta's
+          * root is committed past.
+          */
+         void rebase( std::shared_ptr< state_delta > parent )
+         {
+            KOINOS_ASSERT( !is_root(), internal_error, "Cannot rebase root." );
+            KOINOS_ASSERT( parent, internal_error, "Cannot rebase on to a null delta." );
+
+            _parent = parent;
+         }
+
+         /**
+          * Takes the contents of a flattened copy of this delta, see flatten().
+          *
+          * Children keep pointing at this delta, so they do not need to be
+          * rebased. The flattened delta is left empty.
+          */
+         void replace( state_delta& flat )
+         {
+            KOINOS_ASSERT( flat._id == _id && flat._revision == _revision, internal_error,
+               "Cannot replace a delta with a different delta" );
+
+            _parent = std::move( flat._parent );
+            _indices = std::move( flat._indices );
+            _removed_objects = std::move( flat._removed_objects );
+            _modified_objects = std::move( flat._modified_objects );
+            _next_object_id = flat._next_object_id;
+            _key_filter = std::move( flat._key_filter );
+            _id_filter = std::move( flat._id_filter );
+            _view = std::move( flat._view );
+            _root_indices = std::move( flat._root_indices );
+            _view_base = flat._view_base;
+         }
+
+         uint64_t depth() const
+         {
+            return is_root() ? 0 : _parent->depth() + 1;
+         }
+
+         /**
+          * Builds filters over the keys and ids this delta contains so lookups
+          * that cannot match here skip straight to the parent.
+          *
+          * Deltas of objects with a delta_view also build a view of the chain
+          * back to root, so lookups by id read one map and then root however
+          * deep the delta is. Reads the chain, which must not change meanwhile.
+          *
+          * The delta must not be written to after it is finalized. Squashing in
+          * to the delta drops its filters and view.
+          */
+         void finalize()
+         {
+            if( is_root() ) return;
+
+            if constexpr( key_filter_type::enabled )
+            {
+               _key_filter = std::make_unique< bloom_filter >( _indices->size() );
+
+               for( auto itr = _indices->begin(); itr != _indices->end(); ++itr )
+                  _key_filter->insert( key_filter_type::hash( *itr ) );
+            }
+
+            _id_filter = std::make_unique< bloom_filter >( _modified_objects.size() + _removed_objects.size() );
+
+            for( const auto& id : _modified_objects )
+               _id_filter->insert( hash_id( id ) );
+
+            for( const auto& id : _removed_objects )
+               _id_filter->insert( hash_id( id ) );
+
+            if constexpr( view_type::enabled )
+               build_view();
          }
 
          void clear()
@@ -237,9 +442,10 @@ namespace koinos::statedb::detail {
             _indices->clear();
             _modified_objects.clear();
             _removed_objects.clear();
+            drop_filters();
 
             if( is_root() )
-               _next_object_id = 0;
+               _next_object_id = id_type();
             else
                _next_object_id = _parent->_next_object_id;
 
@@ -253,16 +459,57 @@ namespace koinos::statedb::detail {
             _indices->wipe( dir );
             _modified_objects.clear();
             _removed_objects.clear();
+            drop_filters();
 
             if( is_root() )
-               _next_object_id = 0;
+               _next_object_id = id_type();
             else
                _next_object_id = _parent->_next_object_id;
          }
 
          void flush()
          {
-            _indices->flush();
+            KOINOS_ASSERT( _indices->flush(), internal_error, "Unable to flush state to disk" );
+         }
+
+         /**
+          * Import new objects into the root. Objects with integer ids are
+          * assigned sequential ids in the order given. Objects must not
+          * conflict with existing objects.
+          */
+         template< typename Container >
+         bool ingest( Container& objects )
+         {
+            KOINOS_ASSERT( is_root(), internal_error, "Can only ingest objects in to root." );
+
+            if constexpr( assigns_ids )
+            {
+               id_type next_id = _next_object_id;
+
+               for( auto& obj : objects )
+                  obj.id = next_id++;
+
+               if( !_indices->ingest( objects.begin(), objects.end() ) )
+                  return false;
+
+               _next_object_id = next_id;
+               _indices->set_next_id( _next_object_id );
+               return true;
+            }
+            else
+            {
+               return _indices->ingest( objects.begin(), objects.end() );
+            }
+         }
+
+         void begin_bulk_load()
+         {
+            _indices->begin_bulk_load();
+         }
+
+         void end_bulk_load()
+         {
+            KOINOS_ASSERT( _indices->end_bulk_load(), internal_error, "Unable to write bulk loaded state" );
          }
 
          size_t get_cache_usage() const
@@ -275,6 +522,24 @@ namespace koinos::statedb::detail {
             return _indices->get_cache_size();
          }
 
+         mira::cache_stats get_cache_stats() const
+         {
+            return _indices->get_cache_stats();
+         }
+
+         /**
+          * Metrics of the database, read from the root even while this delta
+          * waits to be written to it.
+          */
+         mira::container_metrics get_metrics() const
+         {
+            auto delta = this;
+            while( !delta->is_root() )
+               delta = delta->_parent.get();
+
+            return delta->_indices->get_metrics();
+         }
+
          void dump_lb_call_counts()
          {
             _indices->dump_lb_call_counts();
@@ -287,13 +552,23 @@ namespace koinos::statedb::detail {
 
          bool is_modified( const id_type& id ) const
          {
-            return _modified_objects.find( id ) != _modified_objects.end()
-               || _removed_objects.find( id ) != _removed_objects.end();
+            if( _id_filter && !_id_filter->may_contain( hash_id( id ) ) )
+               return false;
+
+            return _modified_objects.contains( id ) || _removed_objects.contains( id );
+         }
+
+         bool has_modified_objects() const
+         {
+            return _modified_objects.size() || _removed_objects.size();
          }
 
          bool is_removed( const id_type& id ) const
          {
-            return _removed_objects.find( id ) != _removed_objects.end();
+            if( _id_filter && !_id_filter->may_contain( hash_id( id ) ) )
+               return false;
+
+            return _removed_objects.contains( id );
          }
 
          bool is_root() const
@@ -301,6 +576,17 @@ namespace koinos::statedb::detail {
             return !_parent;
          }
 
+         /**
+          * True if the objects in this delta's own index never change, so
+          * readers may share them rather than copy them. This holds for
+          * finalized deltas not squashed in to since, and for root as long as
+          * its objects are not modified in place.
+          */
+         bool shares_objects() const
+         {
+            return is_root() || _view;
+         }
+
          id_type next_object_id() const
          {
             return _next_object_id;
@@ -328,10 +614,20 @@ namespace koinos::statedb::detail {
             return _id;
          }
 
+         void set_id( const state_node_id& id )
+         {
+            _id = id;
+            if( is_root() )
+               _indices->put_metadata( ID_KEY, _id );
+         }
+
+         /**
+          * The id of the delta this delta was created on. It never changes,
+          * a committed delta still reports the node it followed.
+          */
          const state_node_id& parent_id() const
          {
-            static const state_node_id null_id;
-            return _parent ? _parent->_id : null_id;
+            return _parent_id;
          }
 
          std::shared_ptr< state_delta > parent() const
@@ -350,6 +646,230 @@ namespace koinos::statedb::detail {
          }
 
       private:
+         std::shared_ptr< state_delta > merge_chain()
+         {
+            std::vector< state_delta* > chain;
+            for( auto* delta = this; !delta->is_root(); delta = delta->_parent.get() )
+               chain.push_back( delta );
+
+            auto flat = std::make_shared< state_delta >( get_root(), _id );
+            flat->_parent_id = _parent_id;
+            flat->_revision = _revision;
+
+            for( auto itr = chain.rbegin(); itr != chain.rend(); ++itr )
+               (*itr)->apply_to( *flat );
+
+            return flat;
+         }
+
+         const std::pair< iter_type, bool > insert_new( value_type&& new_obj )
+         {
+            const auto id = new_obj.id;
+            auto emplace_result = _indices->emplace( std::move( new_obj ) );
+
+            if( emplace_result.second )
+            {
+               if constexpr( assigns_ids )
+               {
+                  ++_next_object_id;
+
+                  if( is_root() )
+                     _indices->set_next_id( _next_object_id );
+               }
+
+               if( !is_root() )
+                  _modified_objects.insert( id );
+            }
+
+            return emplace_result;
+         }
+
+         template< typename Modifier >
+         bool modify_existing( const value_type& obj, Modifier&& m )
+         {
+            if( _modified_objects.contains( obj.id ) )
+            {
+               _indices->modify( _indices->iterator_to( obj ), m );
+            }
+            else
+            {
+               value_type mod_obj = obj;
+               m( mod_obj );
+               _indices->emplace( std::move( mod_obj ) );
+               _modified_objects.insert( obj.id );
+            }
+
+            return true;
+         }
+
+         /*
+          * Applies the changes in this delta on top of target. Used to squash
+          * a delta in to its parent and to build a flattened delta.
+          */
+         void apply_to( state_delta& target )
+         {
+            auto apply = [&]()
+            {
+               for( id_type r_id : _removed_objects )
+               {
+                  // An object removed and created again is overwritten below
+                  if( _indices->find( r_id ) != _indices->end() )
+                     continue;
+
+                  auto r_itr = target._indices->find( r_id );
+                  if( r_itr != target._indices->end() )
+                  {
+                     target._indices->erase( r_itr );
+                  }
+               }
+
+               for( auto mod_itr = _indices->begin(); mod_itr != _indices->end(); ++mod_itr )
+               {
+                  auto itr = target._indices->find( mod_itr->id );
+                  if( itr == target._indices->end() )
+                  {
+                     // Objects are unique in the state being squashed, no need to check again
+                     value_type v = *mod_itr;
+                     target._indices->blind_write( [&]()
+                     {
+                        target._indices->emplace( std::move( v ) );
+                     });
+                  }
+                  else
+                  {
+                     target._indices->modify( itr, [&]( value_type& v )
+                     {
+                        v = *mod_itr;
+                     });
+                  }
+               }
+            };
+
+            // Squashing in to root writes every object in a single batch
+            if( target.is_root() )
+               KOINOS_ASSERT( target._indices->batch( apply ), internal_error, "Unable to write squashed state" );
+            else
+               apply();
+
+            target._next_object_id = _next_object_id;
+            target.drop_filters();
+
+            if( target.is_root() )
+            {
+               if constexpr( assigns_ids )
+                  target._indices->set_next_id( _next_object_id );
+            }
+            else
+            {
+               target._removed_objects.reserve( target._removed_objects.size() + _removed_objects.size() );
+               target._removed_objects.insert( _removed_objects.begin(), _removed_objects.end() );
+
+               // There is a corner case where if an object is created in target and
+               // modified here, then target will show it as modified, when it is actually
+               // new. I do not believe this will cause problems, but it is worth noting
+               // it case it does.
+               target._modified_objects.reserve( target._modified_objects.size() + _modified_objects.size() );
+               target._modified_objects.insert( _modified_objects.begin(), _modified_objects.end() );
+            }
+         }
+
+         /*
+          * The view holds every object written or removed from revision
+          * _view_base to this delta. Objects it does not hold are as they are
+          * in root, whose index every delta shares once committed.
+          */
+         const value_type* find_in_view( const id_type& id ) const
+         {
+            if( const auto* entry = _view->find( id ) )
+               return entry->get();
+
+            const auto& by_index = _root_indices->template get< typename view_type::index_tag >();
+            auto itr = by_index.find( id );
+            return itr != by_index.end() ? &*itr : nullptr;
+         }
+
+         std::shared_ptr< const value_type > find_shared_in_view( const id_type& id ) const
+         {
+            if( const auto* entry = _view->find( id ) )
+               return *entry;
+
+            return find_shared_in_root< typename view_type::index_tag >( *_root_indices, id );
+         }
+
+         // Objects in a root without an object cache are copied
+         template< typename IndexedByType, typename CompatibleKey >
+         static std::shared_ptr< const value_type > find_shared_in_root( const index_type& indices, const CompatibleKey& key )
+         {
+            const auto& by_index = indices.template get< IndexedByType >();
+            auto itr = by_index.find( key );
+            if( itr == by_index.end() ) return nullptr;
+
+            if( auto shared = itr.shared() ) return shared;
+
+            return std::make_shared< const value_type >( *itr );
+         }
+
+         /*
+          * Children share the parent's view and add their own objects to it.
+          * Entries from deltas since committed are still correct, root holds
+          * the same objects, but they take memory. Once they span more
+          * revisions than the chain back to root does, the view is built from
+          * the chain again, which costs no more than finalizing it did.
+          */
+         void build_view()
+         {
+            auto root = get_root();
+            _root_indices = root->_indices;
+
+            if( _parent->_view && root->_revision < _parent->_view_base + ( _revision - root->_revision ) )
+            {
+               _view = std::make_unique< view_map >( *_parent->_view );
+               _view_base = _parent->_view_base;
+               add_to_view( *_view );
+               return;
+            }
+
+            std::vector< state_delta* > chain;
+            for( auto* delta = this; !delta->is_root(); delta = delta->_parent.get() )
+               chain.push_back( delta );
+
+            _view = std::make_unique< view_map >();
+            _view_base = root->_revision;
+
+            for( auto itr = chain.rbegin(); itr != chain.rend(); ++itr )
+               (*itr)->add_to_view( *_view );
+         }
+
+         // Entries point in to the delta's index and keep it alive
+         void add_to_view( view_map& view ) const
+         {
+            for( const auto& id : _removed_objects )
+               view.insert_or_assign( id, nullptr );
+
+            for( auto itr = _indices->begin(); itr != _indices->end(); ++itr )
+               view.insert_or_assign( itr->id, std::shared_ptr< const value_type >( _indices, &*itr ) );
+         }
+
+         template< typename IndexedByType, typename CompatibleKey >
+         bool may_contain( const CompatibleKey& key ) const
+         {
+            if constexpr( std::is_same_v< typename key_filter_type::index_tag, IndexedByType > )
+            {
+               if( _key_filter )
+                  return _key_filter->may_contain( key_filter_type::hash( key ) );
+            }
+
+            return true;
+         }
+
+         void drop_filters()
+         {
+            _key_filter.reset();
+            _id_filter.reset();
+            _view.reset();
+            _root_indices.reset();
+         }
+
          bool is_unique( const value_type& v ) const
          {
             flat_set< id_type > conflict_set;
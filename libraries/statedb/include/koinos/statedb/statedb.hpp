@@ -6,7 +6,9 @@
 
 #include <any>
 #include <filesystem>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <vector>
 
 #define STATE_DB_MAX_OBJECT_SIZE 208896
@@ -32,6 +34,15 @@ struct get_object_result
    int64_t         size = 0;
 };
 
+/**
+ * An object read without copying its value out of the database.
+ */
+struct shared_object
+{
+   object_key        key;
+   object_value_ptr  value;   // nullptr if there is no object
+};
+
 struct put_object_args
 {
    object_space    space;
@@ -84,6 +95,26 @@ class state_node final
        */
       void get_prev_object( get_object_result& result, const get_object_args& args )const;
 
+      /**
+       * Fetch an object without copying its value.
+       *
+       * - The value is shared with the database and never changes
+       * - The value stays valid after the node is committed or discarded
+       * - Values written to this node are copied, as the node may still change them
+       * - Returns a null value if the object does not exist
+       */
+      shared_object get_shared_object( const object_space& space, const object_key& key )const;
+
+      /**
+       * Get the next object without copying its value, see get_shared_object().
+       */
+      shared_object get_next_shared_object( const object_space& space, const object_key& key )const;
+
+      /**
+       * Get the previous object without copying its value, see get_shared_object().
+       */
+      shared_object get_prev_shared_object( const object_space& space, const object_key& key )const;
+
       /**
        * Write an object into the state_node.
        *
@@ -122,26 +153,25 @@ using state_node_ptr = std::shared_ptr< state_node >;
  * States are organized as a tree with the assumption that one path wins out
  * over time and cousin paths are discarded as the root is advanced.
  *
- * Currently, state_db is not thread safe. That is, calls directly on state_db
- * are not thread safe. (i.e. deleting a node concurrently to creating a new
- * node can leave statedb in an undefined state)
+ * state_db is thread safe. Looking up nodes (get_node, get_head, get_root,
+ * get_fork_heads) does not lock, it reads an immutable copy of the fork tree
+ * that calls changing the tree replace as a whole. Calls changing the tree
+ * are serialized with each other.
  *
- * Conccurrency across state nodes is supported native to the implementation
- * without locks. Writes on a single state node need to be serialized, but
- * reads are implicitly parallel.
+ * Reads across state nodes are parallel. Writes on a single state node need
+ * to be serialized, and must not run concurrently with reads of that node.
  *
- * TODO: Either extend the design of statedb to support concurrent access
- * or implement a some locking mechanism for access to the fork multi
- * index container.
+ * Upon committing a node, readers may be reading from the node that is being
+ * squashed or an intermediate node between root and that node. Commits happen
+ * infrequently (on the order of once per some number of seconds), so node
+ * reads take a shared lock that commits, flattening and bulk load changes
+ * take exclusively. A commit waits for reads in progress to drain. Nodes
+ * discarded by a commit throw node_discarded when read.
  *
- * There is an additional corner case that is difficult to address.
- *
- * Upon squashing a state node, readers may be reading from the node that
- * is being squashed or an intermediate node between root and that node.
- * Relatively speaking, this should happen infrequently (on the order of once
- * per some number of seconds). As such, whatever guarantees concurrency
- * should heavily favor readers. Writing can happen lazily, preferably when
- * there is no contention from readers at all.
+ * Node lookups do not lock. A node's id and parent id never change, a root
+ * still reports the node it followed. Compound operations that need a
+ * consistent view of several nodes must be serialized with commits by the
+ * caller.
  */
 class state_db final
 {
@@ -156,11 +186,16 @@ class state_db final
 
       /**
        * Close the database.
+       *
+       * Pending commits are written first. If writing a commit failed, the
+       * first error is thrown once the database is closed.
        */
       void close();
 
       /**
        * Reset the database.
+       *
+       * This clears an error writing a previous commit.
        */
       void reset();
 
@@ -220,14 +255,76 @@ class state_db final
        * Branching state between this node and its ancestor will be discarded
        * and no longer accesible.
        *
-       * It is the responsiblity of the caller to ensure no readers or writers
-       * are accessing affected nodes by this call.
+       * The node becomes root immediately. Its deltas are written to the
+       * database in the background, in a single batch, and stay readable
+       * until the write lands. If a write fails, no later commit is written
+       * or accepted. The first error is thrown here, and from flush, until
+       * the database is closed.
        *
-       * TODO: Implement thread safety within commit node to make
-       * statedb thread safe for all callers.
+       * In bulk load mode the commit is written before returning. Either
+       * way, it waits for reads of any node in progress to complete.
        */
       void commit_node( const state_node_id& node_id );
 
+      /**
+       * Bound the number of deltas a read through a finalized node visits.
+       *
+       * If more than max_depth deltas separate the node from root, they are
+       * merged in to a single delta parented on root, which replaces the
+       * node's delta in place, so the node's children see it as well.
+       *
+       * Returns true if the node was flattened.
+       *
+       * The merged delta is built while reads and writes continue, so this
+       * may be called from a background thread. Like commit_node, swapping
+       * it in waits for reads in progress to complete. A node committed or
+       * discarded in the meantime is left as it is.
+       */
+      bool flatten_node( const state_node_id& node_id, uint64_t max_depth );
+
+      /**
+       * Enter bulk load mode.
+       *
+       * While in bulk load mode, writes to the root state are accumulated
+       * in a single batch and written when each commit completes rather
+       * than one object at a time. This is intended for initial sync, where
+       * a large number of blocks are committed in quick succession.
+       */
+      void begin_bulk_load();
+
+      /**
+       * Write any pending batched writes and leave bulk load mode.
+       */
+      void end_bulk_load();
+
+      /**
+       * Flush the root state to persistent storage.
+       *
+       * Waits for commits still being written in the background.
+       */
+      void flush();
+
+      /**
+       * Write the state of a finalized node to a snapshot.
+       *
+       * The snapshot contains every object visible from the node, sorted by
+       * (space, key) and split in to checksummed chunks, along with the
+       * node's revision and id.
+       */
+      void export_snapshot( const state_node_id& node_id, std::ostream& out )const;
+
+      /**
+       * Load a snapshot in to the root node.
+       *
+       * The database must not contain any nodes other than root and root must
+       * be at revision 0. Objects already in root (i.e. genesis data) are
+       * replaced. Root takes the revision and id stored in the snapshot.
+       *
+       * If the import fails, the database is left in an undefined state and
+       * must be reset.
+       */
+      void import_snapshot( std::istream& in );
+
       /**
        * Get and return the current "head" node.
        *
@@ -252,6 +349,13 @@ class state_db final
        */
       state_node_ptr get_root()const;
 
+      /**
+       * Get metrics of the state nodes and of the database holding root.
+       *
+       * Cheap enough to call periodically, see mira::container_metrics.
+       */
+      state_db_metrics get_metrics()const;
+
    private:
       std::unique_ptr< detail::state_db_impl > impl;
 };
@@ -3,8 +3,12 @@
 
 #include <koinos/pack/rt/basetypes.hpp>
 
+#include <mira/metrics.hpp>
+
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include <memory>
+
 namespace koinos::statedb {
 
 KOINOS_DECLARE_EXCEPTION( statedb_exception );
@@ -16,6 +20,11 @@ KOINOS_DECLARE_DERIVED_EXCEPTION( database_not_open, statedb_exception );
  */
 KOINOS_DECLARE_DERIVED_EXCEPTION( node_finalized, statedb_exception );
 
+/**
+ * An attempt was made to access a node after it was discarded.
+ */
+KOINOS_DECLARE_DERIVED_EXCEPTION( node_discarded, statedb_exception );
+
 /**
  * An argument is out of range or otherwise invalid.
  *
@@ -35,6 +44,11 @@ KOINOS_DECLARE_DERIVED_EXCEPTION( illegal_argument, statedb_exception );
  */
 KOINOS_DECLARE_DERIVED_EXCEPTION( cannot_discard, statedb_exception );
 
+/**
+ * A state snapshot could not be written or read, or is corrupt.
+ */
+KOINOS_DECLARE_DERIVED_EXCEPTION( snapshot_error, statedb_exception );
+
 /**
  * An internal invariant has been violated.
  *
@@ -52,4 +66,18 @@ using object_space  = uint256_t;
 using object_key    = uint256_t;
 using object_value  = variable_blob;
 
+// A value shared with the database, see state_node::get_shared_object()
+using object_value_ptr = std::shared_ptr< const object_value >;
+
+/**
+ * Metrics of a state_db, see state_db::get_metrics().
+ */
+struct state_db_metrics
+{
+   uint64_t                nodes = 0;           // State nodes, including root
+   uint64_t                fork_heads = 0;
+   uint64_t                pending_commits = 0; // Committed nodes whose deltas are not yet written to root
+   mira::container_metrics database;            // The container holding root state
+};
+
 } // koinos::statedb
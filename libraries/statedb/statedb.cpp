@@ -5,14 +5,23 @@
 #include <koinos/pack/rt/binary.hpp>
 
 #include <koinos/statedb/detail/objects.hpp>
+#include <koinos/statedb/detail/legacy_objects.hpp>
 #include <koinos/statedb/detail/merge_iterator.hpp>
+#include <koinos/statedb/detail/snapshot.hpp>
 #include <koinos/statedb/detail/state_delta.hpp>
 
 #include <koinos/statedb/statedb.hpp>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <thread>
 #include <utility>
 
 namespace koinos::statedb {
@@ -43,14 +52,74 @@ using state_multi_index_type = boost::multi_index_container<
    >
 >;
 
-using state_delta_type = state_delta< state_object_index >;
+using state_delta_type = state_delta< state_record_index >;
 using state_delta_ptr = std::shared_ptr< state_delta_type >;
 
+// Objects copied per ingested SST file when migrating legacy state.
+constexpr std::size_t legacy_migration_batch_size = 1 << 16;
+
+/**
+ * Moves state written with the legacy layout in to the key addressed layout.
+ *
+ * The legacy database is only removed once all objects, the revision and the
+ * state id have been copied. An interrupted migration discards its partial
+ * copy and starts over the next time the database is opened.
+ */
+void migrate_legacy_state( const std::filesystem::path& p, const std::any& o )
+{
+   // Mira names the database after the value type, see legacy_objects.hpp.
+   const auto legacy_path = p / "rocksdb_state_object";
+   if( !std::filesystem::exists( legacy_path ) )
+      return;
+
+   legacy::state_object_index legacy_index( legacy::state_object_index::type_enum::mira );
+   legacy_index.open( p, o );
+
+   state_record_index index( state_record_index::type_enum::mira );
+   index.open( p, o );
+   index.clear();
+
+   std::vector< state_record > records;
+   records.reserve( legacy_migration_batch_size );
+
+   auto ingest_records = [&]()
+   {
+      KOINOS_ASSERT( index.ingest( records.begin(), records.end() ), internal_error,
+         "Unable to migrate legacy state objects" );
+      records.clear();
+   };
+
+   // The legacy by_key index is ordered by (space, key), the same order as
+   // state_record_id, so each batch sorts after the one before it.
+   const auto& legacy_by_key = legacy_index.get< by_key >();
+   for( auto itr = legacy_by_key.begin(); itr != legacy_by_key.end(); ++itr )
+   {
+      records.emplace_back( state_record{ state_record_id{ itr->space, itr->key }, itr->value } );
+
+      if( records.size() == legacy_migration_batch_size )
+         ingest_records();
+   }
+
+   if( records.size() )
+      ingest_records();
+
+   index.set_revision( legacy_index.revision() );
+
+   state_node_id id;
+   if( legacy_index.get_metadata( ID_KEY, id ) )
+      index.put_metadata( ID_KEY, id );
+
+   index.close();
+   legacy_index.close();
+   legacy_index.wipe( p );
+   std::filesystem::remove_all( legacy_path );
+}
+
 /**
  * Private implementation of state_node interface.
  *
- * Maintains a pointer to state_db_impl,
- * only allows reads / writes if the node corresponds to the DB's current state.
+ * Reads and writes hold the database's delta mutex shared, so they never
+ * observe a delta while commit_node or flatten_node is rewriting it.
  */
 class state_node_impl final
 {
@@ -61,29 +130,69 @@ class state_node_impl final
       void get_object( get_object_result& result, const get_object_args& args )const;
       void get_next_object( get_object_result& result, const get_object_args& args )const;
       void get_prev_object( get_object_result& result, const get_object_args& args )const;
+      shared_object get_shared_object( const object_space& space, const object_key& key )const;
+      shared_object get_next_shared_object( const object_space& space, const object_key& key )const;
+      shared_object get_prev_shared_object( const object_space& space, const object_key& key )const;
       void put_object( put_object_result& result, const put_object_args& args );
       bool is_empty()const;
 
-      state_delta_ptr   _state;
-      bool              _is_writable = true;
+      std::shared_lock< std::shared_mutex > lock_deltas()const;
+
+      state_delta_ptr                        _state;
+      std::atomic< bool >                    _is_writable{ true };
+      std::atomic< bool >                    _is_discarded{ false };
+      std::shared_ptr< std::shared_mutex >   _delta_mutex;
 };
 
 state_node_impl::state_node_impl() {}
 state_node_impl::~state_node_impl() {}
 
+/**
+ * The fork tree as seen by readers.
+ *
+ * A published state_index is never modified. Writers copy the current index,
+ * change the copy and publish it in place of the old one, so readers look up
+ * nodes without taking a lock. A node dropped from the index is reclaimed once
+ * the last index or reader holding it lets go.
+ *
+ * A node's id and parent id never change once it is in an index, so every
+ * published index stays ordered. A committed node keeps its parent id, the
+ * parent is simply no longer in the index.
+ */
+struct state_index
+{
+   state_multi_index_type                    nodes;
+   state_node_ptr                            head;
+   state_node_ptr                            root;
+   std::map< state_node_id, state_node_ptr > fork_heads;
+};
+
+using state_index_ptr = std::shared_ptr< const state_index >;
+
 /**
  * Private implementation of state_db interface.
  *
- * This class relies heavily on using chainbase as a backing store.
- * Only one state_node can be active at a time.  This is enforced by
- * _current_node which is a weak_ptr.  New nodes will throw
- * NodeNotExpired exception if a
+ * Node lookups load the published state_index and do not lock. Changes to
+ * the fork tree serialize on _write_mutex. Changes to the contents of
+ * finalized deltas (commit, flatten, bulk load and reset) additionally take
+ * _delta_mutex exclusively, which waits for in progress node reads to drain.
+ *
+ * Outside of bulk load, committing a node only changes the fork tree. The
+ * commit worker then writes the node's chain of deltas to the database in
+ * the background, in commit order, and makes the node's delta root. The
+ * worker never takes _write_mutex, so writers may wait for it.
  */
 class state_db_impl final
 {
    public:
       state_db_impl() {}
-      ~state_db_impl() { close(); }
+
+      ~state_db_impl()
+      {
+         // Callers that need to know about a commit that failed to write
+         // close the database themselves
+         try { close(); } catch( ... ) {}
+      }
 
       void open( const std::filesystem::path& p, const std::any& o, std::function< void( state_node_ptr ) > init = nullptr );
       void close();
@@ -96,23 +205,90 @@ class state_db_impl final
       void finalize_node( const state_node_id& node );
       void discard_node( const state_node_id& node, const flat_set< state_node_id >& whitelist );
       void commit_node( const state_node_id& node );
+      bool flatten_node( const state_node_id& node, uint64_t max_depth );
+
+      void begin_bulk_load();
+      void end_bulk_load();
+      void flush();
+
+      void export_snapshot( const state_node_id& node_id, std::ostream& out )const;
+      void import_snapshot( std::istream& in );
 
       state_node_ptr get_head()const;
       std::vector< state_node_ptr > get_fork_heads()const;
       state_node_ptr get_root()const;
 
+      state_db_metrics get_metrics()const;
+
       bool is_open()const;
 
+   private:
+      state_index_ptr load_index()const;
+      void publish_index( state_index_ptr index );
+      state_index_ptr open_index();
+      void discard_node( state_index& index, const state_node_id& node, const flat_set< state_node_id >& whitelist );
+
+      void start_commits();
+      void stop_commits();
+      void wait_for_commits();
+      void commit_worker();
+      void write_commit( const state_node_ptr& node );
+
       std::filesystem::path                     _path;
       std::any                                  _options;
       std::function< void( state_node_ptr ) >   _init_func = nullptr;
 
-      state_multi_index_type                    _index;
-      state_node_ptr                            _head;
-      std::map< state_node_id, state_node_ptr > _fork_heads;
-      state_node_ptr                            _root;
+      state_index_ptr                           _index;
+      std::mutex                                _write_mutex;
+      std::shared_ptr< std::shared_mutex >      _delta_mutex = std::make_shared< std::shared_mutex >();
+      bool                                      _bulk_load = false;
+
+      // Committed nodes waiting for their deltas to be written, oldest first.
+      // A node leaves the queue once its delta is root.
+      std::deque< state_node_ptr >              _commit_queue;
+      mutable std::mutex                        _commit_mutex;
+      std::condition_variable                   _commit_cv;
+      std::thread                               _commit_thread;
+      std::exception_ptr                        _commit_error;
+      bool                                      _stop_commits = false;
 };
 
+state_index_ptr state_db_impl::load_index()const
+{
+   return std::atomic_load( &_index );
+}
+
+void state_db_impl::publish_index( state_index_ptr index )
+{
+   std::atomic_store( &_index, std::move( index ) );
+}
+
+state_index_ptr state_db_impl::open_index()
+{
+   migrate_legacy_state( _path, _options );
+
+   auto root = std::make_shared< state_node >();
+   root->impl->_state = std::make_shared< state_delta_type >( _path, _options );
+   root->impl->_delta_mutex = _delta_mutex;
+
+   if ( !root->revision() && root->impl->is_empty() && _init_func )
+   {
+      _init_func( root );
+   }
+
+   if( _bulk_load )
+      root->impl->_state->begin_bulk_load();
+   root->impl->_is_writable = false;
+
+   auto index = std::make_shared< state_index >();
+   index->nodes.insert( root );
+   index->root = root;
+   index->head = root;
+   index->fork_heads.insert_or_assign( root->id(), root );
+
+   return index;
+}
+
 void state_db_impl::reset()
 {
    //
@@ -121,102 +297,219 @@ void state_db_impl::reset()
    // So the caller needs to be very careful to only call this method if deleting the database is desirable!
    //
 
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+
+   // A commit that failed to write is wiped along with everything else
+   {
+      std::unique_lock< std::mutex > commit_lock( _commit_mutex );
+      _commit_cv.wait( commit_lock, [&](){ return _commit_queue.empty(); } );
+      _commit_error = nullptr;
+   }
+
    // Wipe and start over from empty database!
-   _fork_heads.clear();
-   _root->impl->_state->clear();
-   close();
-   open( _path, _options, _init_func );
+   {
+      std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+      index->root->impl->_state->clear();
+   }
+
+   index.reset();
+   publish_index( nullptr );
+   publish_index( open_index() );
 }
 
 void state_db_impl::open( const std::filesystem::path& p, const std::any& o, std::function< void( state_node_ptr ) > init )
 {
-   auto root = std::make_shared< state_node >();
-   root->impl->_state = std::make_shared< state_delta_type >( p, o );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   _path = p;
+   _options = o;
    _init_func = init;
 
-   if ( !root->revision() && root->impl->is_empty() && _init_func )
+   publish_index( open_index() );
+   start_commits();
+}
+
+void state_db_impl::close()
+{
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   stop_commits();
+   publish_index( nullptr );
+
+   // Irreversible state that failed to write is lost once closed, and the
+   // error is cleared when the database is opened again
+   std::lock_guard< std::mutex > commit_lock( _commit_mutex );
+   if( _commit_error )
+      std::rethrow_exception( std::exchange( _commit_error, nullptr ) );
+}
+
+void state_db_impl::start_commits()
+{
+   stop_commits();
+   _stop_commits = false;
+   _commit_error = nullptr;
+   _commit_thread = std::thread( [this](){ commit_worker(); } );
+}
+
+void state_db_impl::stop_commits()
+{
+   if( !_commit_thread.joinable() )
+      return;
+
    {
-      init( root );
+      std::lock_guard< std::mutex > lock( _commit_mutex );
+      _stop_commits = true;
    }
-   root->impl->_is_writable = false;
-   _index.insert( root );
-   _root = root;
-   _head = root;
-   _fork_heads.insert_or_assign( _head->id(), _head );
 
-   _path = p;
-   _options = o;
+   // The worker drains the queue before it exits
+   _commit_cv.notify_all();
+   _commit_thread.join();
 }
 
-void state_db_impl::close()
+void state_db_impl::wait_for_commits()
+{
+   std::unique_lock< std::mutex > lock( _commit_mutex );
+   _commit_cv.wait( lock, [&](){ return _commit_queue.empty(); } );
+
+   if( _commit_error )
+      std::rethrow_exception( _commit_error );
+}
+
+void state_db_impl::commit_worker()
+{
+   std::unique_lock< std::mutex > lock( _commit_mutex );
+
+   while( true )
+   {
+      _commit_cv.wait( lock, [&](){ return _stop_commits || !_commit_queue.empty(); } );
+
+      if( _commit_queue.empty() )
+         return;
+
+      auto node = _commit_queue.front();
+
+      // After a failed write, later commits are not written over the gap. The
+      // chain of the failed commit stays readable, but nothing more reaches
+      // the database until it is reopened.
+      bool failed = bool( _commit_error );
+      lock.unlock();
+
+      std::exception_ptr error;
+
+      if( !failed )
+      {
+         try
+         {
+            write_commit( node );
+         }
+         catch( ... )
+         {
+            error = std::current_exception();
+         }
+      }
+
+      lock.lock();
+
+      // The first error is the one to report, later ones follow from it
+      if( error && !_commit_error )
+         _commit_error = error;
+
+      _commit_queue.pop_front();
+      _commit_cv.notify_all();
+   }
+}
+
+void state_db_impl::write_commit( const state_node_ptr& node )
 {
-   _root.reset();
-   _head.reset();
-   _index.clear();
+   auto state = node->impl->_state;
+   std::vector< state_record_id > written;
+
+   {
+      // flatten_node may replace a delta in the chain, reads may continue
+      std::shared_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+      written = state->write_to_root();
+   }
+
+   // Readers may have cached objects from before the write, and read the
+   // index, parent and contents complete_commit replaces
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   state->complete_commit( written );
+
+   // Eviction frees cached objects, so no reader may be holding one
+   state->trim_cache();
 }
 
 void state_db_impl::get_recent_states( std::vector< state_node_ptr >& node_list, uint64_t limit )
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
+   // Parent ids never change, the published index is walked without locking
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
    node_list.clear();
    node_list.reserve( limit );
-   auto node_itr = _index.find( _head->id() );
+   auto node_itr = index->nodes.find( index->head->id() );
 
-   while( node_list.size() < limit && node_itr != _index.end() )
+   while( node_list.size() < limit && node_itr != index->nodes.end() )
    {
       node_list.emplace_back( *node_itr );
-      if( *node_itr == _root ) return;
+      if( *node_itr == index->root ) return;
 
-      node_itr = _index.find( (*node_itr)->parent_id() );
+      node_itr = index->nodes.find( (*node_itr)->parent_id() );
    }
 }
 
 state_node_ptr state_db_impl::get_node_at_revision( uint64_t revision, const state_node_id& child_id )const
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   KOINOS_ASSERT( revision >= _root->revision(), illegal_argument,
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   KOINOS_ASSERT( revision >= index->root->revision(), illegal_argument,
       "Cannot ask for node with revision less than root. root rev: ${root}, requested: ${req}",
-      ("root", _root->revision())("req", revision) );
-
-   if( revision == _root->revision() ) return _root;
+      ("root", index->root->revision())("req", revision) );
 
-   auto child = get_node( child_id );
-   if( !child ) child = _head;
+   if( revision == index->root->revision() ) return index->root;
 
-   state_delta_ptr delta = child->impl->_state;
+   auto node_itr = index->nodes.find( child_id );
+   auto node = node_itr != index->nodes.end() ? *node_itr : index->head;
 
-   while( delta->revision() > revision )
+   // Walk nodes rather than deltas, a flattened delta skips over its ancestors
+   while( node->revision() > revision )
    {
-      delta = delta->parent();
+      const auto& parent_id = node->parent_id();
+      node_itr = index->nodes.find( parent_id );
+      KOINOS_ASSERT( node_itr != index->nodes.end(), internal_error, "Could not find parent state node ${id}", ("id", parent_id) );
+      node = *node_itr;
    }
 
-   auto node_itr = _index.find( delta->id() );
-   KOINOS_ASSERT( node_itr != _index.end(), internal_error,
-      "Could not find state node associated with linked state_delta ${id}", ("id", delta->id()) );
-   return *node_itr;
+   return node;
 }
 
 state_node_ptr state_db_impl::get_node( const state_node_id& node_id )const
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
 
-   auto node_itr = _index.find( node_id );
-   return node_itr != _index.end() ? *node_itr : state_node_ptr();
+   auto node_itr = index->nodes.find( node_id );
+   return node_itr != index->nodes.end() ? *node_itr : state_node_ptr();
 }
 
 state_node_ptr state_db_impl::create_writable_node( const state_node_id& parent_id, const state_node_id& new_id )
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
 
-   auto parent_state = _index.find( parent_id );
-   if( parent_state != _index.end() && !(*parent_state)->is_writable() )
+   auto parent_state = index->nodes.find( parent_id );
+   if( parent_state != index->nodes.end() && !(*parent_state)->is_writable()
+      && index->nodes.find( new_id ) == index->nodes.end() )
    {
       auto node = std::make_shared< state_node >();
       node->impl->_state = std::make_shared< state_delta_type >( (*parent_state)->impl->_state, new_id );
-      node->impl->_is_writable = true;
-      if( _index.insert( node ).second )
-         return node;
+      node->impl->_delta_mutex = _delta_mutex;
+
+      auto next = std::make_shared< state_index >( *index );
+      next->nodes.insert( node );
+      publish_index( next );
+
+      return node;
    }
 
    return state_node_ptr();
@@ -224,38 +517,66 @@ state_node_ptr state_db_impl::create_writable_node( const state_node_id& parent_
 
 void state_db_impl::finalize_node( const state_node_id& node_id )
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   auto node = get_node( node_id );
-   KOINOS_ASSERT( node, illegal_argument, "Node ${n} not found.", ("n", node_id) );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   auto node_itr = index->nodes.find( node_id );
+   KOINOS_ASSERT( node_itr != index->nodes.end(), illegal_argument, "Node ${n} not found.", ("n", node_id) );
+   auto node = *node_itr;
+
+   {
+      // Finalizing reads the chain back to root, which the commit worker may
+      // be changing, and installs the filters and view readers look at
+      std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+      node->impl->_state->finalize();
+   }
 
    node->impl->_is_writable = false;
 
-   if( node->revision() > _head->revision() )
+   auto next = std::make_shared< state_index >( *index );
+
+   if( node->revision() > next->head->revision() )
    {
-      _head = node;
+      next->head = node;
    }
 
    // When node is finalized, parent node needs to be removed from heads, if it exists.
-   auto parent_itr = _fork_heads.find( node->parent_id() );
-   if ( parent_itr != _fork_heads.end() )
+   auto parent_itr = next->fork_heads.find( node->parent_id() );
+   if ( parent_itr != next->fork_heads.end() )
    {
-      _fork_heads.erase( parent_itr );
+      next->fork_heads.erase( parent_itr );
    }
-   _fork_heads.insert_or_assign( node->id(), node );
+   next->fork_heads.insert_or_assign( node->id(), node );
+
+   publish_index( next );
 }
 
 void state_db_impl::discard_node( const state_node_id& node_id, const flat_set< state_node_id >& whitelist )
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   auto node = get_node( node_id );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
 
-   if( !node ) return;
+   if( index->nodes.find( node_id ) == index->nodes.end() ) return;
 
-   KOINOS_ASSERT( node_id != _root->id(), illegal_argument, "Cannot discard root node" );
+   auto next = std::make_shared< state_index >( *index );
+   discard_node( *next, node_id, whitelist );
+   publish_index( next );
+}
+
+void state_db_impl::discard_node( state_index& index, const state_node_id& node_id, const flat_set< state_node_id >& whitelist )
+{
+   auto node_itr = index.nodes.find( node_id );
+
+   if( node_itr == index.nodes.end() ) return;
+
+   auto node = *node_itr;
+
+   KOINOS_ASSERT( node_id != index.root->id(), illegal_argument, "Cannot discard root node" );
 
    std::vector< state_node_id > remove_queue{ node_id };
-   const auto& previdx = _index.template get< by_parent >();
-   const auto head_id = _head->id();
+   const auto& previdx = index.nodes.template get< by_parent >();
+   const auto head_id = index.head->id();
 
    for( uint32_t i = 0; i < remove_queue.size(); ++i )
    {
@@ -275,58 +596,321 @@ void state_db_impl::discard_node( const state_node_id& node_id, const flat_set<
 
       // We may discard one or more fork heads when discarding a minority fork tree
       // For completeness, we'll check every node to see if it is a fork head
-      auto head_itr = _fork_heads.find( remove_queue[ i ] );
-      if ( head_itr != _fork_heads.end() )
+      auto head_itr = index.fork_heads.find( remove_queue[ i ] );
+      if ( head_itr != index.fork_heads.end() )
       {
-         _fork_heads.erase( head_itr );
+         index.fork_heads.erase( head_itr );
       }
    }
 
    for( const auto& id : remove_queue )
    {
-      auto itr = _index.find( id );
-      if ( itr != _index.end() )
-         _index.erase( itr );
+      auto itr = index.nodes.find( id );
+      if ( itr != index.nodes.end() )
+      {
+         (*itr)->impl->_is_discarded = true;
+         index.nodes.erase( itr );
+      }
    }
 
    // When node is discarded, if the parent node is not a parent of other nodes (no forks), add it to heads.
+   // The old root discarded by commit_node has no parent left in the index.
+   if ( node->id() == index.root->parent_id() )
+      return;
+
    auto fork_itr = previdx.find( node->parent_id() );
    if ( fork_itr == previdx.end() )
    {
-      auto parent_itr = _index.find( node->parent_id() );
-      KOINOS_ASSERT( parent_itr != _index.end(), internal_error, "Discarded parent node not found in node index" );
-      _fork_heads.insert_or_assign( (*parent_itr)->id(), *parent_itr );
+      auto parent_itr = index.nodes.find( node->parent_id() );
+      KOINOS_ASSERT( parent_itr != index.nodes.end(), internal_error, "Discarded parent node not found in node index" );
+      index.fork_heads.insert_or_assign( (*parent_itr)->id(), *parent_itr );
    }
 }
 
 void state_db_impl::commit_node( const state_node_id& node_id )
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   KOINOS_ASSERT( node_id != _root->id(), illegal_argument, "Cannot commit root node. Root node already committed." );
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   KOINOS_ASSERT( node_id != index->root->id(), illegal_argument, "Cannot commit root node. Root node already committed." );
+   auto node_itr = index->nodes.find( node_id );
+   KOINOS_ASSERT( node_itr != index->nodes.end(), illegal_argument, "Node ${n} not found.", ("n", node_id) );
+   auto node = *node_itr;
+
+   {
+      // No commit is accepted once one failed to write, its root never landed
+      std::lock_guard< std::mutex > commit_lock( _commit_mutex );
+      if( _commit_error )
+         std::rethrow_exception( _commit_error );
+   }
+
+   flat_set< state_node_id > whitelist{ node->id() };
+
+   auto next = std::make_shared< state_index >( *index );
+   auto old_root = next->root;
+   auto old_root_state = old_root->impl->_state;
+   next->root = node;
+
+   if( !_bulk_load )
+   {
+      discard_node( *next, old_root->id(), whitelist );
+      publish_index( next );
+
+      std::lock_guard< std::mutex > commit_lock( _commit_mutex );
+      _commit_queue.push_back( node );
+      _commit_cv.notify_all();
+      return;
+   }
+
+   {
+      // Committing makes the node's delta root, which readers of any node may
+      // be traversing. Writing the chain to root, rather than squashing it in
+      // to every delta back to root, leaves shared objects unchanged.
+      std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+
+      next->nodes.modify( next->nodes.find( node->id() ), []( state_node_ptr& n )
+      {
+         n->impl->_state->complete_commit( n->impl->_state->write_to_root() );
+      } );
+      discard_node( *next, old_root->id(), whitelist );
+
+      // Flattened deltas are parented on root and contain everything the new root
+      // does from the old root, so they can move on to the new root unchanged.
+      for( const auto& n : next->nodes )
+      {
+         if( n->impl->_state->parent() == old_root_state )
+            n->impl->_state->rebase( node->impl->_state );
+      }
+
+      node->impl->_state->trim_cache();
+      publish_index( next );
+   }
+}
+
+bool state_db_impl::flatten_node( const state_node_id& node_id, uint64_t max_depth )
+{
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   auto node_itr = index->nodes.find( node_id );
+   KOINOS_ASSERT( node_itr != index->nodes.end(), illegal_argument, "Node ${n} not found.", ("n", node_id) );
+   auto node = *node_itr;
+   KOINOS_ASSERT( !node->is_writable(), illegal_argument, "Cannot flatten a writable node" );
+   KOINOS_ASSERT( node != index->root, illegal_argument, "Cannot flatten root node" );
+
+   std::shared_ptr< state_delta_type > flat;
+
+   {
+      // Building the merged delta only reads the chain, so writers are not
+      // held up by it. The commit worker may make a delta in the chain root
+      // meanwhile.
+      std::shared_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+
+      if( node->impl->_state->depth() <= max_depth )
+         return false;
+
+      flat = node->impl->_state->flatten();
+   }
+
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   index = load_index();
+
+   // The node may have been committed or discarded while flat was built
+   if( node == index->root || index->nodes.find( node_id ) == index->nodes.end() )
+      return false;
+
+   // If root moved on, the delta flat is parented on still shares its index
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   node->impl->_state->replace( *flat );
+
+   return true;
+}
+
+void state_db_impl::begin_bulk_load()
+{
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   wait_for_commits();
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   _bulk_load = true;
+   index->root->impl->_state->begin_bulk_load();
+}
+
+void state_db_impl::end_bulk_load()
+{
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   _bulk_load = false;
+   index->root->impl->_state->end_bulk_load();
+}
+
+void state_db_impl::flush()
+{
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   wait_for_commits();
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   index->root->impl->_state->flush();
+}
+
+void state_db_impl::export_snapshot( const state_node_id& node_id, std::ostream& out )const
+{
    auto node = get_node( node_id );
    KOINOS_ASSERT( node, illegal_argument, "Node ${n} not found.", ("n", node_id) );
+   KOINOS_ASSERT( !node->is_writable(), illegal_argument, "Cannot export a writable node" );
 
-   flat_set< state_node_id > whitelist{ node->id() };
+   auto delta_lock = node->impl->lock_deltas();
 
-   auto old_root = _root;
-   _root = node;
-   _index.modify( _index.find( node->id() ), []( state_node_ptr& n ){ n->impl->_state->commit(); } );
-   discard_node( old_root->id(), whitelist );
+   snapshot_header header;
+   header.revision = node->revision();
+   header.id = node->id();
+   pack::to_binary( out, header );
+
+   std::vector< snapshot_record > records;
+   uint64_t chunk_size = 0;
+   uint64_t record_count = 0;
+
+   auto write_chunk = [&]()
+   {
+      auto blob = pack::to_variable_blob( records );
+
+      snapshot_chunk_header chunk;
+      chunk.record_count = records.size();
+      chunk.size = blob.size();
+      chunk.checksum = crypto::hash_str( CRYPTO_SHA2_256_ID, blob.data(), blob.size() );
+
+      pack::to_binary( out, chunk );
+      out.write( blob.data(), blob.size() );
+
+      record_count += records.size();
+      records.clear();
+      chunk_size = 0;
+   };
+
+   auto idx = merge_index< state_record_index, by_key >( node->impl->_state );
+   for( auto itr = idx.begin(); itr != idx.end(); ++itr )
+   {
+      records.emplace_back( snapshot_record{ itr->id.space.to_uint256(), itr->id.key.to_uint256(), itr->value } );
+      chunk_size += itr->value.size() + 2 * sizeof( object_key );
+
+      if( chunk_size >= snapshot_chunk_size )
+         write_chunk();
+   }
+
+   if( records.size() )
+      write_chunk();
+
+   pack::to_binary( out, snapshot_chunk_header() );
+   pack::to_binary( out, snapshot_footer{ record_count } );
+
+   KOINOS_ASSERT( out.good(), snapshot_error, "Error writing snapshot" );
+}
+
+void state_db_impl::import_snapshot( std::istream& in )
+{
+   std::lock_guard< std::mutex > lock( _write_mutex );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   KOINOS_ASSERT( index->nodes.size() == 1 && index->root->revision() == 0, illegal_argument,
+      "Snapshots can only be imported in to an empty database" );
+
+   std::unique_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+
+   snapshot_header header;
+   pack::from_binary( in, header );
+   KOINOS_ASSERT( in.good() && header.magic == snapshot_magic, snapshot_error, "Stream is not a state snapshot" );
+   KOINOS_ASSERT( header.version == snapshot_version, snapshot_error,
+      "Unsupported snapshot version ${v}", ("v", header.version) );
+
+   auto root_state = index->root->impl->_state;
+
+   // Replace anything written by the init function, the snapshot contains its own copy
+   for( auto itr = root_state->indices()->begin(); itr != root_state->indices()->end(); itr = root_state->indices()->begin() )
+   {
+      state_record obj = *itr;
+      root_state->erase( obj );
+   }
+
+   uint64_t record_count = 0;
+   std::optional< state_record_id > last_id;
+
+   while( true )
+   {
+      snapshot_chunk_header chunk;
+      pack::from_binary( in, chunk );
+      KOINOS_ASSERT( in.good(), snapshot_error, "Unexpected end of snapshot" );
+
+      if( chunk.record_count == 0 )
+         break;
+
+      KOINOS_ASSERT( chunk.size <= 2 * snapshot_chunk_size + STATE_DB_MAX_OBJECT_SIZE, snapshot_error,
+         "Snapshot chunk of ${s} bytes exceeds maximum chunk size", ("s", chunk.size) );
+
+      variable_blob blob( chunk.size );
+      in.read( blob.data(), blob.size() );
+      KOINOS_ASSERT( in.good(), snapshot_error, "Unexpected end of snapshot" );
+      KOINOS_ASSERT( crypto::hash_str( CRYPTO_SHA2_256_ID, blob.data(), blob.size() ) == chunk.checksum, snapshot_error,
+         "Snapshot chunk checksum mismatch after ${n} records", ("n", record_count) );
+
+      auto records = pack::from_variable_blob< std::vector< snapshot_record > >( blob );
+      KOINOS_ASSERT( records.size() == chunk.record_count, snapshot_error, "Snapshot chunk record count mismatch" );
+
+      std::vector< state_record > objects( records.size() );
+      for( size_t i = 0; i < records.size(); ++i )
+      {
+         objects[ i ].id    = state_record_id( records[ i ].space, records[ i ].key );
+         objects[ i ].value = std::move( records[ i ].value );
+
+         // Ingestion only checks uniqueness within a chunk, the order catches duplicates across chunks
+         KOINOS_ASSERT( !last_id || *last_id < objects[ i ].id, snapshot_error,
+            "Snapshot record ${n} is out of order", ("n", record_count + i) );
+         last_id = objects[ i ].id;
+      }
+
+      KOINOS_ASSERT( root_state->ingest( objects ), snapshot_error,
+         "Unable to ingest snapshot chunk after ${n} records", ("n", record_count) );
+
+      record_count += records.size();
+   }
+
+   snapshot_footer footer;
+   pack::from_binary( in, footer );
+   KOINOS_ASSERT( footer.record_count == record_count, snapshot_error,
+      "Snapshot contained ${a} records, expected ${e}", ("a", record_count)("e", footer.record_count) );
+
+   // Changes root's id in place, which keeps the published index, holding
+   // root alone, ordered
+   auto next = std::make_shared< state_index >( *index );
+   next->nodes.modify( next->nodes.find( next->root->id() ), [&]( state_node_ptr& n )
+   {
+      n->impl->_state->set_revision( header.revision );
+      n->impl->_state->set_id( header.id );
+   } );
+
+   next->fork_heads.clear();
+   next->fork_heads.insert_or_assign( next->root->id(), next->root );
+
+   publish_index( next );
 }
 
 state_node_ptr state_db_impl::get_head()const
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   return _head;
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   return index->head;
 }
 
 std::vector< state_node_ptr > state_db_impl::get_fork_heads()const
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
    vector< state_node_ptr > fork_heads;
-   fork_heads.reserve( _fork_heads.size() );
+   fork_heads.reserve( index->fork_heads.size() );
 
-   for( auto& heads : _fork_heads )
+   for( auto& heads : index->fork_heads )
    {
       fork_heads.push_back( heads.second );
    }
@@ -336,22 +920,58 @@ std::vector< state_node_ptr > state_db_impl::get_fork_heads()const
 
 state_node_ptr state_db_impl::get_root()const
 {
-   KOINOS_ASSERT( is_open(), database_not_open, "Database is not open" );
-   return _root;
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+   return index->root;
+}
+
+state_db_metrics state_db_impl::get_metrics()const
+{
+   auto index = load_index();
+   KOINOS_ASSERT( index, database_not_open, "Database is not open" );
+
+   state_db_metrics metrics;
+   metrics.nodes = index->nodes.size();
+   metrics.fork_heads = index->fork_heads.size();
+
+   {
+      std::lock_guard< std::mutex > lock( _commit_mutex );
+      metrics.pending_commits = _commit_queue.size();
+   }
+
+   std::shared_lock< std::shared_mutex > delta_lock( *_delta_mutex );
+   metrics.database = index->root->impl->_state->get_metrics();
+
+   return metrics;
 }
 
 bool state_db_impl::is_open()const
 {
-   return (bool)_root && (bool)_head;
+   return (bool)load_index();
+}
+
+std::shared_lock< std::shared_mutex > state_node_impl::lock_deltas()const
+{
+   // Nodes created outside of a state_db are not shared between threads
+   if( !_delta_mutex )
+      return std::shared_lock< std::shared_mutex >();
+
+   std::shared_lock< std::shared_mutex > lock( *_delta_mutex );
+
+   // A node discarded by a commit may have lost the deltas between it and root
+   KOINOS_ASSERT( !_is_discarded, node_discarded, "Cannot access a discarded node" );
+
+   return lock;
 }
 
 void state_node_impl::get_object( get_object_result& result, const get_object_args& args )const
 {
-   auto idx = merge_index< state_object_index, by_key >( _state );
-   auto pobj = idx.find( boost::make_tuple( args.space, args.key ) );
+   auto delta_lock = lock_deltas();
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   auto pobj = idx.find( state_record_id{ args.space, args.key } );
    if( pobj != nullptr )
    {
-      result.key = pobj->key;
+      result.key = pobj->id.key.to_uint256();
       result.size = pobj->value.size();
       if( (args.buf != nullptr) && (args.buf_size > 0) )
       {
@@ -368,11 +988,14 @@ void state_node_impl::get_object( get_object_result& result, const get_object_ar
 
 void state_node_impl::get_next_object( get_object_result& result, const get_object_args& args )const
 {
-   auto idx = merge_index< state_object_index, by_key >( _state );
-   auto it = idx.upper_bound( boost::make_tuple( args.space, args.key ) );
-   if( (it != idx.end()) && (it->space == args.space) )
+   auto delta_lock = lock_deltas();
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   state_record_id id( args.space, args.key );
+   // The space is the key prefix, stored objects in other spaces are not read
+   auto it = idx.upper_bound_in_prefix( id );
+   if( (it != idx.end()) && (it->id.space == id.space) )
    {
-      result.key = it->key;
+      result.key = it->id.key.to_uint256();
       result.size = it->value.size();
       if( (args.buf != nullptr) && (args.buf_size > 0) )
       {
@@ -389,14 +1012,16 @@ void state_node_impl::get_next_object( get_object_result& result, const get_obje
 
 void state_node_impl::get_prev_object( get_object_result& result, const get_object_args& args )const
 {
-   auto idx = merge_index< state_object_index, by_key >( _state );
-   auto it = idx.lower_bound( boost::make_tuple( args.space, args.key ) );
+   auto delta_lock = lock_deltas();
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   state_record_id id( args.space, args.key );
+   auto it = idx.lower_bound( id );
    if( it != idx.begin() )
    {
       --it;
-      if( it->space == args.space )
+      if( it->id.space == id.space )
       {
-         result.key = it->key;
+         result.key = it->id.key.to_uint256();
          result.size = it->value.size();
          if( (args.buf != nullptr) && (args.buf_size > 0) )
          {
@@ -410,18 +1035,66 @@ void state_node_impl::get_prev_object( get_object_result& result, const get_obje
    result.size = -1;
 }
 
+// The value shares ownership of the record holding it
+shared_object make_shared_object( std::shared_ptr< const state_record > record )
+{
+   if( !record )
+      return shared_object();
+
+   return shared_object{ record->id.key.to_uint256(), object_value_ptr( record, &record->value ) };
+}
+
+shared_object state_node_impl::get_shared_object( const object_space& space, const object_key& key )const
+{
+   auto delta_lock = lock_deltas();
+   return make_shared_object( _state->find_shared< by_key >( state_record_id( space, key ) ) );
+}
+
+shared_object state_node_impl::get_next_shared_object( const object_space& space, const object_key& key )const
+{
+   auto delta_lock = lock_deltas();
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   state_record_id id( space, key );
+   auto it = idx.upper_bound_in_prefix( id );
+   if( (it != idx.end()) && (it->id.space == id.space) )
+      return make_shared_object( it.shared() );
+
+   return shared_object();
+}
+
+shared_object state_node_impl::get_prev_shared_object( const object_space& space, const object_key& key )const
+{
+   auto delta_lock = lock_deltas();
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   state_record_id id( space, key );
+   auto it = idx.lower_bound( id );
+   if( it != idx.begin() )
+   {
+      --it;
+      if( it->id.space == id.space )
+         return make_shared_object( it.shared() );
+   }
+
+   return shared_object();
+}
+
 void state_node_impl::put_object( put_object_result& result, const put_object_args& args )
 {
    KOINOS_ASSERT( _is_writable, node_finalized, "Cannot write to a finalized node" );
-   auto idx = merge_index< state_object_index, by_key >( _state );
-   auto pobj = idx.find( boost::make_tuple( args.space, args.key ) );
+   auto delta_lock = lock_deltas();
+
+   // (space, key) is the object's id and only unique key. Having looked it
+   // up, writes can skip the uniqueness check.
+   auto idx = merge_index< state_record_index, by_key >( _state );
+   state_record_id id( args.space, args.key );
+   auto pobj = idx.find( id );
    if( pobj != nullptr )
    {
       result.object_existed = true;
       if( args.buf != nullptr )
       {
          // exist -> exist, modify()
-         _state->modify( *pobj, [&]( state_object& obj )
+         _state->modify_value( *pobj, [&]( state_record& obj )
          {
             obj.value.resize( args.object_size );
             std::memcpy( obj.value.data(), args.buf, args.object_size );
@@ -439,10 +1112,9 @@ void state_node_impl::put_object( put_object_result& result, const put_object_ar
       if( args.buf != nullptr )
       {
          // dne - exist, create()
-         _state->emplace( [&]( state_object& obj )
+         _state->emplace_unique( [&]( state_record& obj )
          {
-            obj.space = args.space;
-            obj.key = args.key;
+            obj.id = id;
             obj.value.resize( args.object_size );
             std::memcpy( obj.value.data(), args.buf, args.object_size );
          });
@@ -456,6 +1128,7 @@ void state_node_impl::put_object( put_object_result& result, const put_object_ar
 
 bool state_node_impl::is_empty()const
 {
+   auto delta_lock = lock_deltas();
    return _state->is_empty();
 }
 
@@ -479,6 +1152,21 @@ void state_node::get_prev_object( get_object_result& result, const get_object_ar
    impl->get_prev_object( result, args );
 }
 
+shared_object state_node::get_shared_object( const object_space& space, const object_key& key )const
+{
+   return impl->get_shared_object( space, key );
+}
+
+shared_object state_node::get_next_shared_object( const object_space& space, const object_key& key )const
+{
+   return impl->get_next_shared_object( space, key );
+}
+
+shared_object state_node::get_prev_shared_object( const object_space& space, const object_key& key )const
+{
+   return impl->get_prev_shared_object( space, key );
+}
+
 void state_node::put_object( put_object_result& result, const put_object_args& args )
 {
    impl->put_object( result, args );
@@ -564,6 +1252,36 @@ void state_db::commit_node( const state_node_id& node_id )
    impl->commit_node( node_id );
 }
 
+bool state_db::flatten_node( const state_node_id& node_id, uint64_t max_depth )
+{
+   return impl->flatten_node( node_id, max_depth );
+}
+
+void state_db::begin_bulk_load()
+{
+   impl->begin_bulk_load();
+}
+
+void state_db::end_bulk_load()
+{
+   impl->end_bulk_load();
+}
+
+void state_db::flush()
+{
+   impl->flush();
+}
+
+void state_db::export_snapshot( const state_node_id& node_id, std::ostream& out )const
+{
+   impl->export_snapshot( node_id, out );
+}
+
+void state_db::import_snapshot( std::istream& in )
+{
+   impl->import_snapshot( in );
+}
+
 state_node_ptr state_db::get_head()const
 {
    return impl->get_head();
@@ -579,4 +1297,9 @@ state_node_ptr state_db::get_root()const
    return impl->get_root();
 }
 
+state_db_metrics state_db::get_metrics()const
+{
+   return impl->get_metrics();
+}
+
 } // koinos::state_db
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <koinos/chain/controller.hpp>
+#include <koinos/crypto/multihash.hpp>
+#include <koinos/exception.hpp>
+#include <koinos/log.hpp>
+#include <koinos/pack/classes.hpp>
+#include <koinos/pack/rt/binary.hpp>
+#include <koinos/pack/rt/json.hpp>
+
+#include <mira/database_configuration.hpp>
+
+#define HELP_OPTION                          "help"
+#define BLOCKS_OPTION                        "blocks"
+#define FORMAT_OPTION                        "format"
+#define STATEDIR_OPTION                      "statedir"
+#define DATABASE_CONFIG_OPTION               "database-config"
+#define CHAIN_ID_OPTION                      "chain-id"
+#define LIMIT_OPTION                         "limit"
+#define VERIFY_PASSIVE_DATA_OPTION           "verify-passive-data"
+#define VERIFY_BLOCK_SIGNATURE_OPTION        "verify-block-signature"
+#define VERIFY_TRANSACTION_SIGNATURES_OPTION "verify-transaction-signatures"
+
+#define FORMAT_BINARY "binary"
+#define FORMAT_JSONL  "jsonl"
+
+using namespace koinos;
+
+std::string get_default_chain_id_string()
+{
+   // Following is equivalent to {"digest":"z5gosJRaEAWdexTCiVqmjDECb7odR7SrvsNLWxG5NBKhx","hash":18}
+   return "zQmT2TaQZZjwW7HZ6ctY3VCsPvadHV1m6RcwgMNeRUgP1mx";
+}
+
+/**
+ * Read the next block from the file.
+ *
+ * Binary files are a sequence of blocks, each preceded by its serialized
+ * size as a koinos binary encoded uint32. JSONL files contain one JSON
+ * encoded block per line.
+ *
+ * Returns false at the end of the file.
+ */
+bool read_block( std::istream& in, bool jsonl, protocol::block& block )
+{
+   if ( jsonl )
+   {
+      std::string line;
+      while ( std::getline( in, line ) )
+      {
+         if ( line.empty() )
+            continue;
+
+         pack::from_json( pack::json::parse( line ), block );
+         return true;
+      }
+
+      return false;
+   }
+
+   if ( in.peek() == std::char_traits< char >::eof() )
+      return false;
+
+   uint32_t size = 0;
+   pack::from_binary( in, size );
+
+   variable_blob blob( size );
+   in.read( blob.data(), blob.size() );
+
+   if ( !in.good() )
+      throw koinos::exception( "unexpected end of block file" );
+
+   block = pack::from_variable_blob< protocol::block >( blob );
+   return true;
+}
+
+double to_ms( std::chrono::nanoseconds d )
+{
+   return std::chrono::duration< double, std::milli >( d ).count();
+}
+
+double percentile( const std::vector< std::chrono::nanoseconds >& sorted, double p )
+{
+   if ( sorted.empty() )
+      return 0;
+
+   auto index = size_t( std::ceil( p * sorted.size() ) );
+   return to_ms( sorted[ std::clamp< size_t >( index, 1, sorted.size() ) - 1 ] );
+}
+
+int main( int argc, char** argv )
+{
+   std::filesystem::path temp_dir;
+
+   try
+   {
+      boost::program_options::options_description desc( "Koinos block replay options" );
+      desc.add_options()
+         (HELP_OPTION ",h", "Print this help message and exit")
+         (BLOCKS_OPTION ",b", boost::program_options::value< std::string >(), "The block file to replay")
+         (FORMAT_OPTION ",f", boost::program_options::value< std::string >(),
+            "The block file format, " FORMAT_BINARY " or " FORMAT_JSONL " (default: deduced from the file extension)")
+         (STATEDIR_OPTION ",s", boost::program_options::value< std::string >(),
+            "The location of the blockchain state files (default: a temporary directory that is removed on exit)")
+         (DATABASE_CONFIG_OPTION, boost::program_options::value< std::string >(), "The location of the database configuration file")
+         (CHAIN_ID_OPTION, boost::program_options::value< std::string >()->default_value( get_default_chain_id_string() ), "Chain ID to initialize empty node state")
+         (LIMIT_OPTION ",n", boost::program_options::value< uint64_t >()->default_value( 0 ), "Maximum number of blocks to replay (0 for all)")
+         (VERIFY_PASSIVE_DATA_OPTION, boost::program_options::bool_switch()->default_value( false ), "Verify block passive data")
+         (VERIFY_BLOCK_SIGNATURE_OPTION, boost::program_options::bool_switch()->default_value( false ), "Verify block signatures")
+         (VERIFY_TRANSACTION_SIGNATURES_OPTION, boost::program_options::bool_switch()->default_value( false ), "Verify transaction signatures");
+
+      boost::program_options::variables_map vmap;
+      boost::program_options::store( boost::program_options::parse_command_line( argc, argv, desc ), vmap );
+      boost::program_options::notify( vmap );
+
+      if ( vmap.count( HELP_OPTION ) )
+      {
+         std::cout << desc << std::endl;
+         return EXIT_SUCCESS;
+      }
+
+      if ( !vmap.count( BLOCKS_OPTION ) )
+      {
+         std::cout << desc << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      std::filesystem::path block_file = vmap[ BLOCKS_OPTION ].as< std::string >();
+
+      bool jsonl = block_file.extension() == "." FORMAT_JSONL;
+      if ( vmap.count( FORMAT_OPTION ) )
+      {
+         auto format = vmap[ FORMAT_OPTION ].as< std::string >();
+         if ( format != FORMAT_BINARY && format != FORMAT_JSONL )
+         {
+            LOG(error) << "Unknown block file format: " << format;
+            return EXIT_FAILURE;
+         }
+
+         jsonl = format == FORMAT_JSONL;
+      }
+
+      std::ifstream in( block_file, jsonl ? std::ios::in : std::ios::in | std::ios::binary );
+      if ( !in.is_open() )
+      {
+         LOG(error) << "Unable to open block file: " << block_file.string();
+         return EXIT_FAILURE;
+      }
+
+      std::filesystem::path statedir;
+      if ( vmap.count( STATEDIR_OPTION ) )
+      {
+         statedir = std::filesystem::absolute( vmap[ STATEDIR_OPTION ].as< std::string >() );
+      }
+      else
+      {
+         temp_dir = std::filesystem::temp_directory_path() / boost::filesystem::unique_path().string();
+         statedir = temp_dir;
+      }
+
+      if ( !std::filesystem::exists( statedir ) )
+         std::filesystem::create_directories( statedir );
+
+      pack::json database_config = mira::utilities::default_database_configuration();
+      if ( vmap.count( DATABASE_CONFIG_OPTION ) )
+      {
+         std::ifstream config_file( vmap[ DATABASE_CONFIG_OPTION ].as< std::string >(), std::ios::binary );
+         config_file >> database_config;
+      }
+
+      multihash chain_id;
+      pack::from_json( pack::json( vmap[ CHAIN_ID_OPTION ].as< std::string >() ), chain_id );
+
+      chain::genesis_data genesis_data;
+      genesis_data[ KOINOS_STATEDB_CHAIN_ID_KEY ] = pack::to_variable_blob( chain_id );
+
+      chain::controller controller;
+      controller.open( statedir, database_config, genesis_data, false );
+
+      const auto limit = vmap[ LIMIT_OPTION ].as< uint64_t >();
+
+      rpc::chain::submit_block_request request;
+      request.verify_passive_data           = vmap[ VERIFY_PASSIVE_DATA_OPTION ].as< bool >();
+      request.verify_block_signature        = vmap[ VERIFY_BLOCK_SIGNATURE_OPTION ].as< bool >();
+      request.verify_transaction_signatures = vmap[ VERIFY_TRANSACTION_SIGNATURES_OPTION ].as< bool >();
+
+      chain::block_timing timing;
+      std::vector< std::chrono::nanoseconds > latencies;
+      uint64_t transaction_count = 0;
+
+      LOG(info) << "Replaying blocks from " << block_file.string();
+
+      const auto start = std::chrono::steady_clock::now();
+
+      while ( ( !limit || latencies.size() < limit ) && read_block( in, jsonl, request.block ) )
+      {
+         const auto block_start = std::chrono::steady_clock::now();
+         controller.submit_block( request, true, &timing );
+         latencies.push_back( std::chrono::steady_clock::now() - block_start );
+         transaction_count += request.block.transactions.size();
+      }
+
+      const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+      const double seconds = std::chrono::duration< double >( elapsed ).count();
+
+      std::sort( latencies.begin(), latencies.end() );
+
+      auto phase = [&]( const std::string& name, std::chrono::nanoseconds d )
+      {
+         std::cout << "  " << std::left << std::setw( 13 ) << name << std::right
+                   << std::setw( 12 ) << to_ms( d ) << " ms total, "
+                   << std::setw( 9 ) << ( latencies.size() ? to_ms( d ) / latencies.size() : 0 ) << " ms/block, "
+                   << std::setw( 6 ) << ( elapsed.count() ? 100.0 * d.count() / elapsed.count() : 0 ) << "%" << std::endl;
+      };
+
+      std::cout << std::fixed << std::setprecision( 3 );
+      std::cout << "Blocks:         " << latencies.size() << std::endl;
+      std::cout << "Transactions:   " << transaction_count << std::endl;
+      std::cout << "Elapsed:        " << seconds << " s" << std::endl;
+      std::cout << "Blocks/s:       " << ( seconds > 0 ? latencies.size() / seconds : 0 ) << std::endl;
+      std::cout << "Transactions/s: " << ( seconds > 0 ? transaction_count / seconds : 0 ) << std::endl;
+      std::cout << "Latency p50:    " << percentile( latencies, 0.50 ) << " ms" << std::endl;
+      std::cout << "Latency p99:    " << percentile( latencies, 0.99 ) << " ms" << std::endl;
+      std::cout << "Phases:" << std::endl;
+      phase( "create node", timing.create_node );
+      phase( "apply block", timing.apply_block );
+      phase( "commit", timing.commit );
+      phase( "publish", timing.publish );
+   }
+   catch( const koinos::exception& e )
+   {
+      LOG(fatal) << boost::diagnostic_information( e );
+      if ( !temp_dir.empty() ) std::filesystem::remove_all( temp_dir );
+      return EXIT_FAILURE;
+   }
+   catch( const std::exception& e )
+   {
+      LOG(fatal) << e.what();
+      if ( !temp_dir.empty() ) std::filesystem::remove_all( temp_dir );
+      return EXIT_FAILURE;
+   }
+   catch (...)
+   {
+      LOG(fatal) << "unknown error";
+      if ( !temp_dir.empty() ) std::filesystem::remove_all( temp_dir );
+      return EXIT_FAILURE;
+   }
+
+   if ( !temp_dir.empty() ) std::filesystem::remove_all( temp_dir );
+
+   return EXIT_SUCCESS;
+}
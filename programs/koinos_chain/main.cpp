@@ -1,3 +1,5 @@
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
@@ -39,6 +41,10 @@
 #define DATABASE_CONFIG_DEFAULT "database.cfg"
 #define CHAIN_ID_OPTION         "chain-id"
 #define RESET_OPTION            "reset"
+#define EXPORT_SNAPSHOT_OPTION  "export-snapshot"
+#define IMPORT_SNAPSHOT_OPTION  "import-snapshot"
+#define METRICS_INTERVAL_OPTION "metrics-interval"
+#define METRICS_INTERVAL_DEFAULT 60
 
 using namespace boost;
 using namespace koinos;
@@ -219,9 +225,11 @@ void attach_request_handler(
 
 void index_loop(
    chain::controller& controller,
-   concurrent::sync_bounded_queue< std::shared_future< std::string > >& rpc_queue )
+   concurrent::sync_bounded_queue< std::shared_future< std::string > >& rpc_queue,
+   const std::atomic< bool >& stopped,
+   std::atomic< bool >& failed )
 {
-   while( true )
+   while( !stopped )
    {
       std::shared_future< std::string > future;
       try
@@ -256,6 +264,9 @@ void index_loop(
 
          for ( auto& block_item : batch.block_items )
          {
+            if ( stopped )
+               break;
+
             controller.submit_block( {
                .block = block_item.block.get_const_native(),
                .verify_passive_data = false,
@@ -267,17 +278,82 @@ void index_loop(
       catch ( const boost::exception& e )
       {
          LOG(error) << "Index error: " << boost::diagnostic_information( e );
-         exit( EXIT_FAILURE );
+         failed = true;
       }
       catch ( const std::exception& e )
       {
          LOG(error) << "Index error: " << e.what();
-         exit( EXIT_FAILURE );
+         failed = true;
+      }
+
+      // Exiting here would lose the blocks applied since the last checkpoint
+      if ( failed )
+      {
+         rpc_queue.close();
+         break;
       }
    }
 }
 
-void index( chain::controller& controller, std::shared_ptr< mq::client > mq_client )
+void log_metrics( const statedb::state_db_metrics& m )
+{
+   const auto& db = m.database;
+
+   LOG(info) << "Database metrics -"
+      << " nodes: " << m.nodes
+      << ", fork heads: " << m.fork_heads
+      << ", pending commits: " << m.pending_commits
+      << ", object cache hits: " << db.object_cache.hits
+      << ", misses: " << db.object_cache.misses
+      << ", evictions: " << db.object_cache.evictions
+      << ", usage: " << db.object_cache.usage << "/" << db.object_cache.capacity
+      << ", block cache usage: " << db.block_cache_usage
+      << ", memtable size: " << db.memtable_size
+      << ", pending compaction bytes: " << db.pending_compaction_bytes
+      << ", write stops: " << db.write_stops
+      << ", write slowdowns: " << db.write_slowdowns
+      << ", writes stopped: " << db.write_stopped
+      << ", reads: " << db.reads
+      << ", writes: " << db.writes;
+
+   for ( const auto& c : db.columns )
+   {
+      LOG(debug) << "Column " << c.name << " metrics -"
+         << " reads: " << c.reads
+         << ", writes: " << c.writes
+         << ", memtable size: " << c.memtable_size
+         << ", pending compaction bytes: " << c.pending_compaction_bytes;
+   }
+}
+
+/**
+ * Logs database metrics every interval until the timer is cancelled.
+ */
+void schedule_metrics( asio::steady_timer& timer, std::chrono::seconds interval, const chain::controller& controller )
+{
+   timer.expires_after( interval );
+   timer.async_wait( [&timer, interval, &controller]( const system::error_code& ec )
+   {
+      if ( ec == asio::error::operation_aborted )
+         return;
+
+      try
+      {
+         log_metrics( controller.get_metrics() );
+      }
+      catch ( const std::exception& e )
+      {
+         LOG(warning) << "Error gathering database metrics: " << e.what();
+      }
+
+      schedule_metrics( timer, interval, controller );
+   } );
+}
+
+/**
+ * Returns true if indexing was interrupted by a signal.
+ */
+bool index( chain::controller& controller, std::shared_ptr< mq::client > mq_client )
 {
    using namespace rpc::block_store;
    try
@@ -316,16 +392,38 @@ void index( chain::controller& controller, std::shared_ptr< mq::client > mq_clie
          LOG(info) << "Indexing to target block: " << target_head;
 
          concurrent::sync_bounded_queue< std::shared_future< std::string > > rpc_queue{ 10 };
+         std::atomic< bool > stopped = false;
+         std::atomic< bool > failed = false;
+
+         asio::io_service io_service;
+         asio::signal_set signals( io_service, SIGINT, SIGTERM );
+
+         signals.async_wait( [&]( const system::error_code& err, int num )
+         {
+            if ( err )
+               return;
+
+            LOG(info) << "Caught signal, stopping indexing...";
+            stopped = true;
+            rpc_queue.close();
+         } );
+
+         auto signal_thread = std::make_unique< std::thread >( [&]()
+         {
+            io_service.run();
+         } );
+
+         controller.begin_bulk_sync();
 
          auto index_thread = std::make_unique< std::thread >( [&]()
          {
-            index_loop( controller, rpc_queue );
+            index_loop( controller, rpc_queue, stopped, failed );
          } );
 
          multihash last_id = crypto::zero_hash( CRYPTO_SHA2_256_ID );
          block_height_type last_height = head_info.head_topology.height;
 
-         while ( last_height < target_head.height )
+         while ( !stopped && last_height < target_head.height )
          {
             get_blocks_by_height_request req {
                .head_block_id         = target_head.id,
@@ -336,17 +434,43 @@ void index( chain::controller& controller, std::shared_ptr< mq::client > mq_clie
             };
 
             pack::to_json( j, block_store_request{ req } );
-            rpc_queue.push_back( mq_client->rpc( service::block_store, j.dump() ) );
+
+            try
+            {
+               rpc_queue.push_back( mq_client->rpc( service::block_store, j.dump() ) );
+            }
+            catch ( const concurrent::sync_queue_is_closed& )
+            {
+               break;
+            }
+            catch ( const std::exception& e )
+            {
+               LOG(error) << "Index error: " << e.what();
+               failed = true;
+               break;
+            }
+
             last_height += block_height_type{ batch_size };
          }
 
          rpc_queue.close();
          index_thread->join();
 
+         signals.cancel();
+         signal_thread->join();
+
+         // Checkpoint irreversible state to disk, whether finished, interrupted or failed
+         controller.end_bulk_sync();
+
+         if ( failed )
+            exit( EXIT_FAILURE );
+
          auto new_head_info = controller.get_head_info();
 
          const std::chrono::duration< double > duration = std::chrono::system_clock::now() - before;
          LOG(info) << "Finished indexing " << new_head_info.head_topology.height - head_info.head_topology.height << " blocks, took " << duration.count() << " seconds";
+
+         return stopped;
       }
    }
    catch ( const std::exception& e )
@@ -354,6 +478,8 @@ void index( chain::controller& controller, std::shared_ptr< mq::client > mq_clie
       LOG(error) << "Index error: " << e.what();
       exit( EXIT_FAILURE );
    }
+
+   return false;
 }
 
 template< typename T >
@@ -393,7 +519,10 @@ int main( int argc, char** argv )
          (DATABASE_CONFIG_OPTION, program_options::value< std::string >(),
             "The location of the database configuration file (absolute path or relative to basedir/chain)")
          (CHAIN_ID_OPTION       , program_options::value< std::string >(), "Chain ID to initialize empty node state")
-         (RESET_OPTION          , program_options::bool_switch()->default_value(false), "Reset the database");
+         (RESET_OPTION          , program_options::bool_switch()->default_value(false), "Reset the database")
+         (EXPORT_SNAPSHOT_OPTION, program_options::value< std::string >(), "Export the irreversible state to a snapshot file and exit")
+         (IMPORT_SNAPSHOT_OPTION, program_options::value< std::string >(), "Initialize an empty database from a snapshot file")
+         (METRICS_INTERVAL_OPTION, program_options::value< uint64_t >(), "Seconds between database metrics log lines, 0 to disable");
 
       program_options::variables_map args;
       program_options::store( program_options::parse_command_line( argc, argv, options ), args );
@@ -441,6 +570,7 @@ int main( int argc, char** argv )
       auto statedir             = std::filesystem::path( get_option< std::string >( STATEDIR_OPTION, STATEDIR_DEFAULT, args, chain_config ) );
       auto database_config_path = std::filesystem::path( get_option< std::string >( DATABASE_CONFIG_OPTION, DATABASE_CONFIG_DEFAULT, args, chain_config ) );
       auto chain_id_str         = get_option< std::string >( CHAIN_ID_OPTION, get_default_chain_id_string(), args, chain_config );
+      auto metrics_interval     = get_option< uint64_t >( METRICS_INTERVAL_OPTION, METRICS_INTERVAL_DEFAULT, args, chain_config );
 
       koinos::initialize_logging( service::chain, instance_id, log_level, basedir / service::chain );
 
@@ -492,6 +622,17 @@ int main( int argc, char** argv )
       chain::controller controller;
       controller.open( statedir, database_config, genesis_data, args[ RESET_OPTION ].as< bool >() );
 
+      if ( args.count( EXPORT_SNAPSHOT_OPTION ) )
+      {
+         controller.export_snapshot( args[ EXPORT_SNAPSHOT_OPTION ].as< std::string >() );
+         return EXIT_SUCCESS;
+      }
+
+      if ( args.count( IMPORT_SNAPSHOT_OPTION ) )
+      {
+         controller.import_snapshot( args[ IMPORT_SNAPSHOT_OPTION ].as< std::string >() );
+      }
+
       auto mq_client = std::make_shared< mq::client >();
       auto request_handler = mq::request_handler();
 
@@ -520,7 +661,11 @@ int main( int argc, char** argv )
          LOG(info) << "Established connection to mempool";
       }
 
-      index( controller, mq_client );
+      if ( index( controller, mq_client ) )
+      {
+         LOG(info) << "Shut down successfully";
+         return EXIT_SUCCESS;
+      }
 
       attach_client( controller, mq_client, amqp_url );
       attach_request_handler( controller, request_handler, amqp_url );
@@ -528,13 +673,18 @@ int main( int argc, char** argv )
 
       asio::io_service io_service;
       asio::signal_set signals( io_service, SIGINT, SIGTERM );
+      asio::steady_timer metrics_timer( io_service );
 
       signals.async_wait( [&]( const system::error_code& err, int num )
       {
          LOG(info) << "Caught signal, shutting down...";
+         metrics_timer.cancel();
          request_handler.stop();
       } );
 
+      if ( metrics_interval )
+         schedule_metrics( metrics_timer, std::chrono::seconds( metrics_interval ), controller );
+
       io_service.run();
       LOG(info) << "Shut down successfully";
 
@@ -0,0 +1,495 @@
+#include <benchmark/benchmark.h>
+
+#include <koinos/crypto/multihash.hpp>
+#include <koinos/statedb/detail/merge_iterator.hpp>
+#include <koinos/statedb/detail/objects.hpp>
+#include <koinos/statedb/detail/state_delta.hpp>
+#include <koinos/statedb/statedb.hpp>
+
+#include <mira/database_configuration.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <any>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace koinos;
+using namespace koinos::statedb;
+using statedb::detail::by_key;
+using statedb::detail::merge_index;
+using statedb::detail::state_delta;
+using statedb::detail::state_record;
+using statedb::detail::state_record_id;
+using statedb::detail::state_record_index;
+
+namespace {
+
+constexpr uint64_t root_objects      = 10000;
+constexpr uint64_t delta_modified    = 32;
+constexpr uint64_t delta_created     = 8;
+constexpr uint64_t iteration_length  = 64;
+constexpr uint64_t airdrop_objects   = 100000;
+constexpr uint64_t object_size       = 32;
+
+// Root kinds, the first argument of benchmarks run against both
+constexpr int64_t  rocksdb_root      = 0;
+constexpr int64_t  memory_root       = 1;
+
+using state_delta_type = state_delta< state_record_index >;
+using state_delta_ptr = std::shared_ptr< state_delta_type >;
+
+std::filesystem::path make_temp_directory()
+{
+   auto temp = std::filesystem::temp_directory_path() / boost::filesystem::unique_path().string();
+   std::filesystem::create_directory( temp );
+   return temp;
+}
+
+/*
+ * A chain of state deltas on top of a root, persistent unless in_memory.
+ *
+ * The root holds objects with even keys. Every delta above it modifies a
+ * handful of existing objects and creates a few new objects with odd keys,
+ * which is roughly what a block does to state.
+ */
+struct delta_chain
+{
+   std::filesystem::path   temp;
+   state_delta_ptr         root;
+   state_delta_ptr         head;
+   uint64_t                objects;
+   uint64_t                value_size;
+   std::mt19937_64         rng;
+
+   delta_chain( uint64_t depth, uint64_t count = root_objects, bool in_memory = false, uint64_t size = object_size ) :
+      objects( count ),
+      value_size( size )
+   {
+      if( in_memory )
+      {
+         root = std::make_shared< state_delta_type >( state_delta_ptr(), crypto::zero_hash( CRYPTO_SHA2_256_ID ) );
+      }
+      else
+      {
+         temp = make_temp_directory();
+         std::any cfg = mira::utilities::default_database_configuration();
+         root = std::make_shared< state_delta_type >( temp, cfg );
+      }
+
+      for( uint64_t i = 0; i < objects; ++i )
+         put( root, 2 * i );
+
+      head = root;
+      uint64_t next_key = 1;
+
+      for( uint64_t d = 1; d < depth; ++d )
+      {
+         head = std::make_shared< state_delta_type >( head, head->id() );
+
+         for( uint64_t i = 0; i < delta_modified; ++i )
+            put( head, 2 * ( rng() % objects ) );
+
+         for( uint64_t i = 0; i < delta_created; ++i, next_key += 2 )
+            put( head, next_key );
+      }
+   }
+
+   ~delta_chain()
+   {
+      head.reset();
+      root.reset();
+
+      if( !temp.empty() )
+         std::filesystem::remove_all( temp );
+   }
+
+   object_key random_key()
+   {
+      return object_key( rng() % ( 2 * objects ) );
+   }
+
+   void put( const state_delta_ptr& delta, uint64_t k )
+   {
+      object_key key( k );
+      object_value value( value_size, char( k ) );
+
+      const auto* obj = delta->find< by_key >( state_record_id{ object_space(), key } );
+
+      if( obj )
+      {
+         delta->modify_value( *obj, [&]( state_record& o ) { o.value = value; } );
+      }
+      else
+      {
+         delta->emplace_unique( [&]( state_record& o )
+         {
+            o.id.key = statedb::detail::fixed_key( key );
+            o.value = value;
+         });
+      }
+   }
+};
+
+/*
+ * The same shape as delta_chain, built through the state_db API. The root
+ * objects are committed and written to the database, the nodes above root
+ * are finalized but not committed.
+ */
+struct node_chain
+{
+   std::filesystem::path   temp;
+   state_db                db;
+   uint64_t                objects;
+   uint64_t                value_size;
+   uint64_t                next_node_id = 1;
+   std::vector< char >     buf;
+   std::mt19937_64         rng;
+
+   node_chain( uint64_t depth, uint64_t count = root_objects, uint64_t size = object_size ) :
+      temp( make_temp_directory() ),
+      objects( count ),
+      value_size( size ),
+      buf( size )
+   {
+      db.open( temp, mira::utilities::default_database_configuration() );
+
+      auto node = create_node();
+      for( uint64_t i = 0; i < objects; ++i )
+         put( node, 2 * i );
+
+      db.finalize_node( node->id() );
+      db.commit_node( node->id() );
+      db.flush();
+
+      uint64_t next_key = 1;
+
+      for( uint64_t d = 1; d < depth; ++d )
+      {
+         node = create_node();
+
+         for( uint64_t i = 0; i < delta_modified; ++i )
+            put( node, 2 * ( rng() % objects ) );
+
+         for( uint64_t i = 0; i < delta_created; ++i, next_key += 2 )
+            put( node, next_key );
+
+         db.finalize_node( node->id() );
+      }
+   }
+
+   ~node_chain()
+   {
+      db.close();
+      std::filesystem::remove_all( temp );
+   }
+
+   state_node_ptr create_node( const state_node_ptr& parent = state_node_ptr() )
+   {
+      auto parent_id = parent ? parent->id() : db.get_head()->id();
+      return db.create_writable_node( parent_id, crypto::hash( CRYPTO_SHA2_256_ID, next_node_id++ ) );
+   }
+
+   object_key random_key()
+   {
+      return object_key( rng() % ( 2 * objects ) );
+   }
+
+   void put( const state_node_ptr& node, const object_key& key )
+   {
+      put_object_args args;
+      put_object_result result;
+      args.space = object_space();
+      args.key = key;
+      args.buf = buf.data();
+      args.object_size = buf.size();
+      node->put_object( result, args );
+   }
+
+   get_object_args get_args( const object_key& key )
+   {
+      get_object_args args;
+      args.space = object_space();
+      args.key = key;
+      args.buf = buf.data();
+      args.buf_size = buf.size();
+      return args;
+   }
+};
+
+} // anonymous
+
+static void merge_iterator_lower_bound( benchmark::State& state )
+{
+   delta_chain chain( state.range( 0 ) );
+
+   for( auto _ : state )
+   {
+      auto idx = merge_index< state_record_index, by_key >( chain.head );
+      auto itr = idx.lower_bound( state_record_id{ object_space(), chain.random_key() } );
+      if( itr != idx.end() )
+         benchmark::DoNotOptimize( itr->id.key );
+   }
+}
+
+static void merge_iterator_forward( benchmark::State& state )
+{
+   delta_chain chain( state.range( 0 ) );
+
+   for( auto _ : state )
+   {
+      auto idx = merge_index< state_record_index, by_key >( chain.head );
+      auto itr = idx.lower_bound( state_record_id{ object_space(), chain.random_key() } );
+
+      for( uint64_t i = 0; i < iteration_length && itr != idx.end(); ++i, ++itr )
+         benchmark::DoNotOptimize( itr->id.key );
+   }
+
+   state.SetItemsProcessed( state.iterations() * iteration_length );
+}
+
+static void merge_iterator_backward( benchmark::State& state )
+{
+   delta_chain chain( state.range( 0 ) );
+
+   for( auto _ : state )
+   {
+      auto idx = merge_index< state_record_index, by_key >( chain.head );
+      auto itr = idx.lower_bound( state_record_id{ object_space(), chain.random_key() } );
+      auto begin = idx.begin();
+
+      for( uint64_t i = 0; i < iteration_length && itr != begin; ++i )
+         benchmark::DoNotOptimize( (--itr)->id.key );
+   }
+
+   state.SetItemsProcessed( state.iterations() * iteration_length );
+}
+
+/*
+ * A single block touching every object in state, like a large airdrop. Each
+ * object is modified in a new delta, which is then squashed in to a parent
+ * delta that already holds modifications of its own.
+ */
+static void state_delta_bulk_modify( benchmark::State& state )
+{
+   delta_chain chain( 2, state.range( 0 ) );
+
+   for( auto _ : state )
+   {
+      auto delta = std::make_shared< state_delta_type >( chain.head, chain.head->id() );
+
+      for( uint64_t i = 0; i < chain.objects; ++i )
+         chain.put( delta, 2 * i );
+
+      delta->finalize();
+      delta->squash();
+   }
+
+   state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+
+/*
+ * Point reads through a delta chain, as get_object does. Arguments are the
+ * root kind, the chain depth and the number of root objects.
+ */
+static void state_delta_find( benchmark::State& state )
+{
+   delta_chain chain( state.range( 1 ), state.range( 2 ), state.range( 0 ) == memory_root );
+
+   for( auto _ : state )
+   {
+      auto idx = merge_index< state_record_index, by_key >( chain.head );
+      benchmark::DoNotOptimize( idx.find( state_record_id{ object_space(), chain.random_key() } ) );
+   }
+}
+
+/*
+ * Writes to a new delta on top of a chain, as put_object does. Arguments are
+ * the root kind, the chain depth and the value size.
+ */
+static void state_delta_put( benchmark::State& state )
+{
+   delta_chain chain( state.range( 1 ), root_objects, state.range( 0 ) == memory_root, state.range( 2 ) );
+   auto delta = std::make_shared< state_delta_type >( chain.head, chain.head->id() );
+
+   for( auto _ : state )
+      chain.put( delta, chain.rng() % ( 2 * chain.objects ) );
+
+   state.SetBytesProcessed( state.iterations() * state.range( 2 ) );
+}
+
+/*
+ * get_object on the head node. Arguments are the chain depth and the value
+ * size.
+ */
+static void state_db_get_object( benchmark::State& state )
+{
+   node_chain chain( state.range( 0 ), root_objects, state.range( 1 ) );
+   auto head = chain.db.get_head();
+   get_object_result result;
+
+   for( auto _ : state )
+   {
+      head->get_object( result, chain.get_args( chain.random_key() ) );
+      benchmark::DoNotOptimize( result.size );
+   }
+}
+
+/*
+ * put_object to a writable node on top of the head. Arguments are the chain
+ * depth and the value size.
+ */
+static void state_db_put_object( benchmark::State& state )
+{
+   node_chain chain( state.range( 0 ), root_objects, state.range( 1 ) );
+   auto node = chain.create_node();
+
+   for( auto _ : state )
+      chain.put( node, chain.random_key() );
+
+   state.SetBytesProcessed( state.iterations() * state.range( 1 ) );
+}
+
+/*
+ * get_next_object from random keys on the head node. The argument is the
+ * chain depth.
+ */
+static void state_db_get_next_object( benchmark::State& state )
+{
+   node_chain chain( state.range( 0 ) );
+   auto head = chain.db.get_head();
+   get_object_result result;
+
+   for( auto _ : state )
+   {
+      head->get_next_object( result, chain.get_args( chain.random_key() ) );
+      benchmark::DoNotOptimize( result.size );
+   }
+}
+
+/*
+ * get_prev_object from random keys on the head node. The argument is the
+ * chain depth.
+ */
+static void state_db_get_prev_object( benchmark::State& state )
+{
+   node_chain chain( state.range( 0 ) );
+   auto head = chain.db.get_head();
+   get_object_result result;
+
+   for( auto _ : state )
+   {
+      head->get_prev_object( result, chain.get_args( chain.random_key() ) );
+      benchmark::DoNotOptimize( result.size );
+   }
+}
+
+/*
+ * The life of a block's node: created on the head, written, finalized and
+ * committed. The argument is the number of objects the block writes.
+ * Commits are written to the database in the background, the time to
+ * write the last of them is not measured.
+ */
+static void state_db_block_cycle( benchmark::State& state )
+{
+   node_chain chain( 1 );
+
+   for( auto _ : state )
+   {
+      auto node = chain.create_node();
+
+      for( int64_t i = 0; i < state.range( 0 ); ++i )
+         chain.put( node, chain.random_key() );
+
+      chain.db.finalize_node( node->id() );
+      chain.db.commit_node( node->id() );
+   }
+
+   // Outside of the timed loop
+   chain.db.flush();
+
+   state.SetItemsProcessed( state.iterations() );
+}
+
+/*
+ * Competing blocks on the head, of which one is committed and the others are
+ * discarded with it. The argument is the fork fan-out.
+ */
+static void state_db_fork_commit( benchmark::State& state )
+{
+   node_chain chain( 1 );
+
+   for( auto _ : state )
+   {
+      auto head = chain.db.get_head();
+      state_node_ptr first;
+
+      for( int64_t f = 0; f < state.range( 0 ); ++f )
+      {
+         auto node = chain.create_node( head );
+
+         for( uint64_t i = 0; i < delta_modified; ++i )
+            chain.put( node, chain.random_key() );
+
+         chain.db.finalize_node( node->id() );
+
+         if( !first )
+            first = node;
+      }
+
+      chain.db.commit_node( first->id() );
+   }
+
+   state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+
+/*
+ * Writable nodes on the head that are discarded, like pending transactions
+ * that are dropped. The argument is the fork fan-out.
+ */
+static void state_db_fork_discard( benchmark::State& state )
+{
+   node_chain chain( 1 );
+   auto head = chain.db.get_head();
+   std::vector< state_node_ptr > forks;
+
+   for( auto _ : state )
+   {
+      for( int64_t f = 0; f < state.range( 0 ); ++f )
+      {
+         forks.push_back( chain.create_node( head ) );
+
+         for( uint64_t i = 0; i < delta_modified; ++i )
+            chain.put( forks.back(), chain.random_key() );
+      }
+
+      for( const auto& node : forks )
+         chain.db.discard_node( node->id() );
+
+      forks.clear();
+   }
+
+   state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+
+BENCHMARK( merge_iterator_lower_bound )->RangeMultiplier( 2 )->Range( 1, 64 );
+BENCHMARK( merge_iterator_forward )->RangeMultiplier( 2 )->Range( 1, 64 );
+BENCHMARK( merge_iterator_backward )->RangeMultiplier( 2 )->Range( 1, 64 );
+BENCHMARK( state_delta_bulk_modify )->Arg( airdrop_objects )->Unit( benchmark::kMillisecond );
+
+BENCHMARK( state_delta_find )
+   ->ArgNames( { "memory_root", "depth", "objects" } )
+   ->Ranges( { { rocksdb_root, memory_root }, { 1, 64 }, { 1 << 10, 1 << 16 } } );
+BENCHMARK( state_delta_put )
+   ->ArgNames( { "memory_root", "depth", "value_size" } )
+   ->Ranges( { { rocksdb_root, memory_root }, { 1, 64 }, { 32, 4096 } } );
+
+BENCHMARK( state_db_get_object )->ArgNames( { "depth", "value_size" } )->Ranges( { { 1, 64 }, { 32, 4096 } } );
+BENCHMARK( state_db_put_object )->ArgNames( { "depth", "value_size" } )->Ranges( { { 1, 64 }, { 32, 4096 } } );
+BENCHMARK( state_db_get_next_object )->ArgName( "depth" )->RangeMultiplier( 4 )->Range( 1, 64 );
+BENCHMARK( state_db_get_prev_object )->ArgName( "depth" )->RangeMultiplier( 4 )->Range( 1, 64 );
+BENCHMARK( state_db_block_cycle )->ArgName( "objects" )->RangeMultiplier( 8 )->Range( 8, 512 );
+BENCHMARK( state_db_fork_commit )->ArgName( "fan_out" )->RangeMultiplier( 2 )->Range( 1, 16 );
+BENCHMARK( state_db_fork_discard )->ArgName( "fan_out" )->RangeMultiplier( 2 )->Range( 1, 16 );
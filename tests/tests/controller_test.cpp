@@ -9,11 +9,13 @@
 #include <koinos/crypto/multihash.hpp>
 #include <koinos/crypto/elliptic.hpp>
 #include <koinos/pack/rt/binary.hpp>
+#include <koinos/statedb/detail/objects.hpp>
 
 #include <mira/database_configuration.hpp>
 
 #include <chrono>
 #include <filesystem>
+#include <numeric>
 #include <sstream>
 
 using namespace std::string_literals;
@@ -325,4 +327,114 @@ BOOST_AUTO_TEST_CASE( fork_heads )
 
 } KOINOS_CATCH_LOG_AND_RETHROW(info) }
 
+BOOST_AUTO_TEST_CASE( bulk_sync_checkpoint )
+{ try {
+   using namespace koinos;
+
+   BOOST_TEST_MESSAGE( "Applying blocks in bulk sync" );
+
+   rpc::chain::submit_block_request block_req;
+   block_req.verify_passive_data = true;
+   block_req.verify_block_signature = true;
+   block_req.verify_transaction_signatures = true;
+
+   uint64_t test_timestamp = 1609459200;
+   auto head_info = _controller.get_head_info();
+
+   _controller.begin_bulk_sync( 5 );
+
+   for( int i = 1; i <= 30; i++ )
+   {
+      block_req.block.active_data.make_mutable();
+      block_req.block.header.timestamp = test_timestamp + i;
+      block_req.block.header.height    = head_info.head_topology.height + 1;
+      block_req.block.header.previous  = head_info.head_topology.id;
+
+      set_block_merkle_roots( block_req.block, CRYPTO_SHA2_256_ID );
+      sign_block( block_req.block, _block_signing_private_key );
+
+      block_req.block.id = crypto::hash_n( CRYPTO_SHA2_256_ID, block_req.block.header, block_req.block.active_data );
+
+      _controller.submit_block( block_req );
+
+      head_info = _controller.get_head_info();
+   }
+
+   _controller.end_bulk_sync();
+
+   BOOST_TEST_MESSAGE( "Checking the checkpoint survives without closing the database" );
+
+   // Writes skip the WAL, so a copy taken while the database is open only
+   // holds what was flushed, as after a crash
+   auto copy_dir = std::filesystem::temp_directory_path() / boost::filesystem::unique_path().string();
+   std::filesystem::copy( _state_dir, copy_dir, std::filesystem::copy_options::recursive );
+
+   {
+      statedb::detail::state_record_index index( statedb::detail::state_record_index::type_enum::mira );
+      BOOST_REQUIRE( index.open( copy_dir, mira::utilities::default_database_configuration() ) );
+
+      BOOST_CHECK( index.revision() == head_info.last_irreversible_height );
+      BOOST_CHECK_GT( index.size(), 0 );
+      BOOST_CHECK_EQUAL( index.size(), uint64_t( std::distance( index.begin(), index.end() ) ) );
+
+      index.close();
+   }
+
+   std::filesystem::remove_all( copy_dir );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( bulk_sync_depth )
+{ try {
+   using namespace koinos;
+
+   BOOST_TEST_MESSAGE( "Applying blocks in bulk sync without advancing root" );
+
+   rpc::chain::submit_block_request block_req;
+   block_req.verify_passive_data = true;
+   block_req.verify_block_signature = true;
+   block_req.verify_transaction_signatures = true;
+
+   const int num_blocks = 300;
+   const int window = 50;
+
+   uint64_t test_timestamp = 1609459200;
+   auto head_info = _controller.get_head_info();
+   std::vector< std::chrono::nanoseconds > commit_times;
+
+   _controller.begin_bulk_sync( 1000 );
+
+   for( int i = 1; i <= num_blocks; i++ )
+   {
+      block_req.block.active_data.make_mutable();
+      block_req.block.header.timestamp = test_timestamp + i;
+      block_req.block.header.height    = head_info.head_topology.height + 1;
+      block_req.block.header.previous  = head_info.head_topology.id;
+
+      set_block_merkle_roots( block_req.block, CRYPTO_SHA2_256_ID );
+      sign_block( block_req.block, _block_signing_private_key );
+
+      block_req.block.id = crypto::hash_n( CRYPTO_SHA2_256_ID, block_req.block.header, block_req.block.active_data );
+
+      chain::block_timing timing;
+      _controller.submit_block( block_req, false, &timing );
+      commit_times.push_back( timing.commit );
+
+      head_info = _controller.get_head_info();
+   }
+
+   BOOST_TEST_MESSAGE( "Checking the time to commit a block does not grow with the chain" );
+
+   // Skip the first blocks while caches warm up
+   auto sum = []( auto first, auto last ) { return std::accumulate( first, last, std::chrono::nanoseconds( 0 ) ); };
+   auto shallow = sum( commit_times.begin() + window, commit_times.begin() + 2 * window );
+   auto deep = sum( commit_times.end() - window, commit_times.end() );
+
+   BOOST_TEST_MESSAGE( "Shallow: " << shallow.count() << "ns, deep: " << deep.count() << "ns" );
+   BOOST_CHECK_LT( deep.count(), 3 * shallow.count() );
+
+   _controller.end_bulk_sync();
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,8 +5,14 @@
 #include <koinos/exception.hpp>
 #include <koinos/pack/rt/binary.hpp>
 #include <koinos/pack/rt/json.hpp>
+#include <koinos/statedb/detail/bloom_filter.hpp>
+#include <koinos/statedb/detail/fixed_key.hpp>
+#include <koinos/statedb/detail/id_set.hpp>
+#include <koinos/statedb/detail/legacy_objects.hpp>
 #include <koinos/statedb/detail/merge_iterator.hpp>
 #include <koinos/statedb/detail/objects.hpp>
+#include <koinos/statedb/detail/persistent_map.hpp>
+#include <koinos/statedb/detail/snapshot.hpp>
 #include <koinos/statedb/detail/state_delta.hpp>
 #include <koinos/statedb/statedb.hpp>
 
@@ -15,8 +21,14 @@
 #include <boost/container/deque.hpp>
 #include <boost/interprocess/streams/vectorstream.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <filesystem>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 using namespace koinos;
 using namespace koinos::statedb;
@@ -1476,4 +1488,1206 @@ BOOST_AUTO_TEST_CASE( reset_test )
 
 } KOINOS_CATCH_LOG_AND_RETHROW(info) }
 
+BOOST_AUTO_TEST_CASE( bulk_load_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Committing blocks in bulk load mode" );
+   object_space space = 0;
+   const uint64_t num_blocks = 50;
+   db.begin_bulk_load();
+
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   std::vector< char > buf( 1024 );
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+   {
+      auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, i ) );
+      BOOST_REQUIRE( node );
+
+      put_args.space = space;
+      put_args.key = i;
+      put_args.buf = reinterpret_cast< const char* >( &i );
+      put_args.object_size = sizeof( i );
+      node->put_object( put_res, put_args );
+      BOOST_REQUIRE( !put_res.object_existed );
+
+      // Overwrite the same object every block
+      put_args.key = 0;
+      node->put_object( put_res, put_args );
+      BOOST_REQUIRE( put_res.object_existed == ( i > 1 ) );
+
+      // Remove the object written two blocks ago
+      if( i > 2 )
+      {
+         put_args.key = i - 2;
+         put_args.buf = nullptr;
+         node->put_object( put_res, put_args );
+         BOOST_REQUIRE( put_res.object_existed );
+      }
+
+      db.finalize_node( node->id() );
+      db.commit_node( node->id() );
+   }
+
+   auto check_state = [&]( state_node_ptr root )
+   {
+      BOOST_REQUIRE_EQUAL( root->revision(), num_blocks );
+
+      for( uint64_t i = 0; i <= num_blocks; ++i )
+      {
+         get_args.space = space;
+         get_args.key = i;
+         get_args.buf = buf.data();
+         get_args.buf_size = buf.size();
+         root->get_object( get_res, get_args );
+
+         if( i == 0 || i >= num_blocks - 1 )
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( uint64_t ) ) );
+            uint64_t value = *reinterpret_cast< uint64_t* >( buf.data() );
+            BOOST_REQUIRE_EQUAL( value, i == 0 ? num_blocks : i );
+         }
+         else
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+         }
+      }
+   };
+
+   BOOST_TEST_MESSAGE( "Checking committed state while in bulk load mode" );
+   check_state( db.get_root() );
+
+   db.end_bulk_load();
+   db.flush();
+
+   BOOST_TEST_MESSAGE( "Checking committed state after reopening" );
+   db.close();
+   db.open( temp, mira::utilities::default_database_configuration() );
+   check_state( db.get_root() );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( snapshot_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Writing state across committed and reversible nodes" );
+   const uint64_t num_objects = 100;
+   put_object_args put_args;
+   put_object_result put_res;
+
+   auto put = [&]( state_node_ptr node, object_space space, object_key key, const std::string& value )
+   {
+      put_args.space = space;
+      put_args.key = key;
+      put_args.buf = value.size() ? value.data() : nullptr;
+      put_args.object_size = value.size();
+      node->put_object( put_res, put_args );
+   };
+
+   auto node_1 = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, 1 ) );
+   for( uint64_t i = 0; i < num_objects; ++i )
+      put( node_1, i % 3, num_objects - i, "value_" + std::to_string( i ) );
+   db.finalize_node( node_1->id() );
+   db.commit_node( node_1->id() );
+
+   auto node_2 = db.create_writable_node( node_1->id(), crypto::hash( CRYPTO_SHA2_256_ID, 2 ) );
+   put( node_2, 0, num_objects * 2, "new" );
+   put( node_2, 1, num_objects - 1, "modified" );
+   put( node_2, 2, num_objects - 2, "" );
+   db.finalize_node( node_2->id() );
+
+   BOOST_TEST_MESSAGE( "Exporting snapshot" );
+   std::stringstream snapshot;
+   db.export_snapshot( node_2->id(), snapshot );
+
+   auto read_all = []( state_node_ptr node )
+   {
+      std::vector< std::tuple< object_space, object_key, std::string > > objects;
+      std::vector< char > buf( 1024 );
+      get_object_args get_args;
+      get_object_result get_res;
+
+      for( object_space space = 0; space < 3; ++space )
+      {
+         get_args.space = space;
+         get_args.key = 0;
+         get_args.buf = buf.data();
+         get_args.buf_size = buf.size();
+         node->get_object( get_res, get_args );
+
+         if( get_res.size >= 0 )
+            objects.emplace_back( space, get_args.key, std::string( buf.data(), get_res.size ) );
+
+         while( true )
+         {
+            node->get_next_object( get_res, get_args );
+            if( get_res.size < 0 ) break;
+            objects.emplace_back( space, get_res.key, std::string( buf.data(), get_res.size ) );
+            get_args.key = get_res.key;
+         }
+      }
+
+      return objects;
+   };
+
+   auto expected = read_all( node_2 );
+   BOOST_REQUIRE_EQUAL( expected.size(), num_objects );
+
+   BOOST_TEST_MESSAGE( "Importing snapshot in to a new database" );
+   auto import_dir = std::filesystem::temp_directory_path() / boost::filesystem::unique_path().string();
+   std::filesystem::create_directory( import_dir );
+
+   {
+      state_db import_db;
+      import_db.open( import_dir, mira::utilities::default_database_configuration() );
+      import_db.import_snapshot( snapshot );
+
+      auto root = import_db.get_root();
+      BOOST_REQUIRE( root->id() == node_2->id() );
+      BOOST_REQUIRE_EQUAL( root->revision(), node_2->revision() );
+      BOOST_REQUIRE( import_db.get_head()->id() == node_2->id() );
+      BOOST_REQUIRE( read_all( root ) == expected );
+
+      BOOST_TEST_MESSAGE( "Checking new objects can be written after import" );
+      auto node_3 = import_db.create_writable_node( root->id(), crypto::hash( CRYPTO_SHA2_256_ID, 3 ) );
+      BOOST_REQUIRE( node_3 );
+      put( node_3, 0, num_objects * 3, "after_import" );
+      BOOST_REQUIRE( !put_res.object_existed );
+      put( node_3, 0, num_objects * 2, "overwritten" );
+      BOOST_REQUIRE( put_res.object_existed );
+      import_db.finalize_node( node_3->id() );
+      import_db.commit_node( node_3->id() );
+
+      BOOST_TEST_MESSAGE( "Checking snapshot cannot be imported in to a non-empty database" );
+      snapshot.clear();
+      snapshot.seekg( 0 );
+      BOOST_REQUIRE_THROW( import_db.import_snapshot( snapshot ), illegal_argument );
+      import_db.close();
+   }
+
+   std::filesystem::remove_all( import_dir );
+
+   BOOST_TEST_MESSAGE( "Checking corrupt snapshots are rejected" );
+   auto corrupt = snapshot.str();
+   corrupt[ corrupt.size() / 2 ] ^= 0x01;
+   std::stringstream corrupt_snapshot( corrupt );
+
+   std::filesystem::create_directory( import_dir );
+
+   {
+      state_db import_db;
+      import_db.open( import_dir, mira::utilities::default_database_configuration() );
+      BOOST_REQUIRE_THROW( import_db.import_snapshot( corrupt_snapshot ), snapshot_error );
+      import_db.close();
+   }
+
+   std::filesystem::remove_all( import_dir );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( snapshot_order_test )
+{ try {
+   using statedb::detail::snapshot_record;
+
+   auto make_snapshot = []( const std::vector< std::vector< snapshot_record > >& chunks )
+   {
+      std::stringstream ss;
+      statedb::detail::snapshot_header header;
+      header.revision = 1;
+      header.id = crypto::hash( CRYPTO_SHA2_256_ID, 1 );
+      pack::to_binary( ss, header );
+
+      uint64_t record_count = 0;
+      for( const auto& records : chunks )
+      {
+         auto blob = pack::to_variable_blob( records );
+
+         statedb::detail::snapshot_chunk_header chunk;
+         chunk.record_count = records.size();
+         chunk.size = blob.size();
+         chunk.checksum = crypto::hash_str( CRYPTO_SHA2_256_ID, blob.data(), blob.size() );
+
+         pack::to_binary( ss, chunk );
+         ss.write( blob.data(), blob.size() );
+         record_count += records.size();
+      }
+
+      pack::to_binary( ss, statedb::detail::snapshot_chunk_header() );
+      pack::to_binary( ss, statedb::detail::snapshot_footer{ record_count } );
+      return ss;
+   };
+
+   auto record = []( uint64_t key )
+   {
+      return snapshot_record{ 0, key, object_value( 1, char( key ) ) };
+   };
+
+   auto import_dir = std::filesystem::temp_directory_path() / boost::filesystem::unique_path().string();
+
+   BOOST_TEST_MESSAGE( "Importing ordered records split across chunks" );
+   std::filesystem::create_directory( import_dir );
+
+   {
+      auto snapshot = make_snapshot( { { record( 1 ), record( 2 ) }, { record( 3 ), record( 4 ) } } );
+
+      state_db import_db;
+      import_db.open( import_dir, mira::utilities::default_database_configuration() );
+      import_db.import_snapshot( snapshot );
+      BOOST_REQUIRE_EQUAL( import_db.get_root()->revision(), 1 );
+      import_db.close();
+   }
+
+   std::filesystem::remove_all( import_dir );
+
+   BOOST_TEST_MESSAGE( "Checking a duplicate record split across chunks is rejected" );
+   std::filesystem::create_directory( import_dir );
+
+   {
+      auto snapshot = make_snapshot( { { record( 1 ), record( 2 ) }, { record( 2 ), record( 3 ) } } );
+
+      state_db import_db;
+      import_db.open( import_dir, mira::utilities::default_database_configuration() );
+      BOOST_REQUIRE_THROW( import_db.import_snapshot( snapshot ), snapshot_error );
+      import_db.close();
+   }
+
+   std::filesystem::remove_all( import_dir );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( delta_filter_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Checking bloom filters do not have false negatives" );
+   statedb::detail::bloom_filter filter( 1000 );
+
+   for( uint64_t i = 0; i < 1000; ++i )
+      filter.insert( statedb::detail::mix_hash( i ) );
+
+   uint64_t false_positives = 0;
+   for( uint64_t i = 0; i < 2000; ++i )
+   {
+      if( i < 1000 )
+         BOOST_REQUIRE( filter.may_contain( statedb::detail::mix_hash( i ) ) );
+      else if( filter.may_contain( statedb::detail::mix_hash( i ) ) )
+         ++false_positives;
+   }
+
+   BOOST_REQUIRE_LT( false_positives, uint64_t( 50 ) );
+
+   BOOST_TEST_MESSAGE( "Reading through finalized nodes" );
+   object_space space = 0;
+   const uint64_t num_blocks = 20;
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   std::vector< char > buf( 1024 );
+
+   std::vector< state_node_ptr > nodes;
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+   {
+      auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, i ) );
+      BOOST_REQUIRE( node );
+
+      put_args.space = space;
+      put_args.key = i;
+      put_args.buf = reinterpret_cast< const char* >( &i );
+      put_args.object_size = sizeof( i );
+      node->put_object( put_res, put_args );
+
+      put_args.key = 0;
+      node->put_object( put_res, put_args );
+
+      if( i > 2 )
+      {
+         put_args.key = i - 2;
+         put_args.buf = nullptr;
+         node->put_object( put_res, put_args );
+         BOOST_REQUIRE( put_res.object_existed );
+      }
+
+      db.finalize_node( node->id() );
+      nodes.push_back( node );
+   }
+
+   auto check_node = [&]( state_node_ptr node, uint64_t height )
+   {
+      for( uint64_t i = 0; i <= num_blocks + 1; ++i )
+      {
+         get_args.space = space;
+         get_args.key = i;
+         get_args.buf = buf.data();
+         get_args.buf_size = buf.size();
+         node->get_object( get_res, get_args );
+
+         if( i == 0 || ( i <= height && i + 2 > height ) )
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( uint64_t ) ) );
+            uint64_t value = *reinterpret_cast< uint64_t* >( buf.data() );
+            BOOST_REQUIRE_EQUAL( value, i == 0 ? height : i );
+         }
+         else
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+         }
+      }
+   };
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+   BOOST_TEST_MESSAGE( "Reading after committing part of the chain" );
+   db.commit_node( nodes[ num_blocks / 2 - 1 ]->id() );
+
+   for( uint64_t i = num_blocks / 2; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( flatten_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Building a chain of finalized nodes" );
+   object_space space = 0;
+   const uint64_t num_blocks = 20;
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   std::vector< char > buf( 1024 );
+
+   std::vector< state_node_ptr > nodes;
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+   {
+      auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, i ) );
+      BOOST_REQUIRE( node );
+
+      put_args.space = space;
+      put_args.key = i;
+      put_args.buf = reinterpret_cast< const char* >( &i );
+      put_args.object_size = sizeof( i );
+      node->put_object( put_res, put_args );
+
+      put_args.key = 0;
+      node->put_object( put_res, put_args );
+
+      if( i > 2 )
+      {
+         put_args.key = i - 2;
+         put_args.buf = nullptr;
+         node->put_object( put_res, put_args );
+      }
+
+      db.finalize_node( node->id() );
+      nodes.push_back( node );
+   }
+
+   auto check_node = [&]( state_node_ptr node, uint64_t height )
+   {
+      for( uint64_t i = 0; i <= num_blocks + 1; ++i )
+      {
+         get_args.space = space;
+         get_args.key = i;
+         get_args.buf = buf.data();
+         get_args.buf_size = buf.size();
+         node->get_object( get_res, get_args );
+
+         if( i == 0 || ( i <= height && i + 2 > height ) )
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( uint64_t ) ) );
+            uint64_t value = *reinterpret_cast< uint64_t* >( buf.data() );
+            BOOST_REQUIRE_EQUAL( value, i == 0 ? height : i );
+         }
+         else
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+         }
+      }
+
+      // Iteration sees exactly key 0 and the two most recent keys
+      get_args.key = 0;
+      node->get_next_object( get_res, get_args );
+      BOOST_REQUIRE( get_res.key == object_key( height > 1 ? height - 1 : height ) );
+      get_args.key = get_res.key;
+      node->get_next_object( get_res, get_args );
+
+      if( height > 1 )
+      {
+         BOOST_REQUIRE( get_res.key == object_key( height ) );
+         get_args.key = get_res.key;
+         node->get_next_object( get_res, get_args );
+      }
+
+      BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+   };
+
+   BOOST_TEST_MESSAGE( "Flattening a node" );
+   BOOST_REQUIRE( !db.flatten_node( nodes[ 11 ]->id(), num_blocks ) );
+   BOOST_REQUIRE( db.flatten_node( nodes[ 11 ]->id(), 4 ) );
+   BOOST_REQUIRE( !db.flatten_node( nodes[ 11 ]->id(), 4 ) );
+   BOOST_REQUIRE_THROW( db.flatten_node( db.get_root()->id(), 0 ), illegal_argument );
+
+   auto writable = db.create_writable_node( nodes.back()->id(), crypto::hash( CRYPTO_SHA2_256_ID, num_blocks + 1 ) );
+   BOOST_REQUIRE( writable );
+   BOOST_REQUIRE_THROW( db.flatten_node( writable->id(), 0 ), illegal_argument );
+   db.discard_node( writable->id() );
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+   {
+      check_node( nodes[ i - 1 ], i );
+      BOOST_REQUIRE( nodes[ i - 1 ]->parent_id() == ( i > 1 ? nodes[ i - 2 ]->id() : db.get_root()->id() ) );
+   }
+
+   BOOST_REQUIRE( db.get_node_at_revision( 8, nodes.back()->id() )->id() == nodes[ 7 ]->id() );
+
+   BOOST_TEST_MESSAGE( "Committing an ancestor of the flattened node" );
+   db.commit_node( nodes[ 4 ]->id() );
+
+   for( uint64_t i = 5; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+   BOOST_TEST_MESSAGE( "Flattening the head and committing the flattened node" );
+   BOOST_REQUIRE( db.flatten_node( nodes.back()->id(), 4 ) );
+   db.commit_node( nodes[ 11 ]->id() );
+
+   for( uint64_t i = 12; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+   db.commit_node( nodes.back()->id() );
+   check_node( db.get_root(), num_blocks );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( persistent_map_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Checking copies of a persistent map do not see each other's inserts" );
+   typedef statedb::detail::persistent_map< uint64_t, uint64_t > map_type;
+   map_type a;
+   std::vector< map_type > versions;
+
+   BOOST_REQUIRE( a.empty() );
+   BOOST_REQUIRE( a.find( 0 ) == nullptr );
+
+   for( uint64_t i = 0; i < 1000; ++i )
+   {
+      versions.push_back( a );
+      a.insert_or_assign( i, i );
+   }
+
+   auto b = a;
+   for( uint64_t i = 0; i < 1000; i += 2 )
+      b.insert_or_assign( i, i + 1 );
+
+   BOOST_REQUIRE_EQUAL( a.size(), 1000 );
+   BOOST_REQUIRE_EQUAL( b.size(), 1000 );
+   BOOST_REQUIRE( a.find( 1000 ) == nullptr );
+
+   for( uint64_t i = 0; i < 1000; ++i )
+   {
+      BOOST_REQUIRE_EQUAL( *a.find( i ), i );
+      BOOST_REQUIRE_EQUAL( *b.find( i ), i % 2 ? i : i + 1 );
+
+      BOOST_REQUIRE_EQUAL( versions[ i ].size(), i );
+      BOOST_REQUIRE( versions[ i ].find( i ) == nullptr );
+      if( i > 0 )
+         BOOST_REQUIRE_EQUAL( *versions[ i ].find( i - 1 ), i - 1 );
+   }
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( delta_view_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Reading through a long chain of finalized nodes" );
+   object_space space = 0;
+   const uint64_t num_blocks = 100;
+   const uint64_t num_keys = 10;
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   std::vector< char > buf( 1024 );
+
+   // Nodes by height, root is height 0
+   std::vector< state_node_ptr > nodes{ db.get_root() };
+
+   // Block i writes i to key i % num_keys and removes key ( i + 1 ) % num_keys
+   auto add_block = [&]( state_node_ptr parent, uint64_t i, uint64_t fork )
+   {
+      auto node = db.create_writable_node( parent->id(), crypto::hash( CRYPTO_SHA2_256_ID, i + fork * 1000 ) );
+      BOOST_REQUIRE( node );
+
+      uint64_t value = i + fork * 1000;
+      put_args.space = space;
+      put_args.key = i % num_keys;
+      put_args.buf = reinterpret_cast< const char* >( &value );
+      put_args.object_size = sizeof( value );
+      node->put_object( put_res, put_args );
+
+      if( !fork )
+      {
+         put_args.key = ( i + 1 ) % num_keys;
+         put_args.buf = nullptr;
+         node->put_object( put_res, put_args );
+      }
+
+      db.finalize_node( node->id() );
+      return node;
+   };
+
+   auto read = [&]( state_node_ptr node, uint64_t key ) -> int64_t
+   {
+      get_args.space = space;
+      get_args.key = key;
+      get_args.buf = buf.data();
+      get_args.buf_size = buf.size();
+      node->get_object( get_res, get_args );
+
+      if( get_res.size < 0 )
+         return -1;
+
+      BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( uint64_t ) ) );
+      return *reinterpret_cast< uint64_t* >( buf.data() );
+   };
+
+   // The last write to key at or below height, unless it has been removed since
+   auto expected = [&]( uint64_t height, uint64_t key ) -> int64_t
+   {
+      for( uint64_t j = height; j > 0; --j )
+      {
+         if( j % num_keys == key )
+            return height < j + num_keys - 1 ? int64_t( j ) : -1;
+      }
+
+      return -1;
+   };
+
+   auto check_node = [&]( uint64_t height )
+   {
+      for( uint64_t k = 0; k < num_keys; ++k )
+         BOOST_REQUIRE_EQUAL( read( nodes[ height ], k ), expected( height, k ) );
+   };
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+      nodes.push_back( add_block( nodes.back(), i, 0 ) );
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+      check_node( i );
+
+   BOOST_TEST_MESSAGE( "Reading a fork sharing the view of its parent" );
+   const uint64_t fork_height = num_blocks / 2;
+   std::vector< state_node_ptr > fork{ nodes[ fork_height ] };
+
+   for( uint64_t i = 1; i <= num_keys / 2; ++i )
+      fork.push_back( add_block( fork.back(), fork_height + i, 1 ) );
+
+   auto check_fork = [&]()
+   {
+      for( uint64_t i = 1; i < fork.size(); ++i )
+      {
+         for( uint64_t k = 0; k < num_keys; ++k )
+         {
+            // The fork writes keys following the fork height and removes nothing
+            uint64_t offset = ( k + num_keys - fork_height % num_keys ) % num_keys;
+            if( offset >= 1 && offset <= i )
+               BOOST_REQUIRE_EQUAL( read( fork[ i ], k ), int64_t( fork_height + offset + 1000 ) );
+            else
+               BOOST_REQUIRE_EQUAL( read( fork[ i ], k ), expected( fork_height, k ) );
+         }
+      }
+   };
+
+   check_fork();
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+      check_node( i );
+
+   BOOST_TEST_MESSAGE( "Reading after committing a common ancestor" );
+   db.commit_node( nodes[ fork_height - num_keys ]->id() );
+
+   check_fork();
+
+   for( uint64_t i = fork_height - num_keys; i <= num_blocks; ++i )
+      check_node( i );
+
+   BOOST_TEST_MESSAGE( "Reading while root follows the head" );
+   db.discard_node( fork[ 1 ]->id() );
+
+   for( uint64_t i = num_blocks + 1; i <= 3 * num_blocks; ++i )
+   {
+      nodes.push_back( add_block( nodes.back(), i, 0 ) );
+      db.commit_node( nodes[ i - num_keys ]->id() );
+      check_node( i );
+      check_node( i - num_keys / 2 );
+   }
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( shared_object_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Reading shared objects from finalized nodes" );
+   object_space space = 0;
+   put_object_args put_args;
+   put_object_result put_res;
+
+   auto put = [&]( state_node_ptr node, uint64_t key, const std::string& value )
+   {
+      put_args.space = space;
+      put_args.key = key;
+      put_args.buf = value.data();
+      put_args.object_size = value.size();
+      node->put_object( put_res, put_args );
+   };
+
+   auto value_of = []( const shared_object& object )
+   {
+      BOOST_REQUIRE( object.value );
+      return std::string( object.value->begin(), object.value->end() );
+   };
+
+   const std::string large( 100000, 'a' );
+
+   auto node_1 = db.create_writable_node( db.get_root()->id(), crypto::hash( CRYPTO_SHA2_256_ID, 1 ) );
+   BOOST_REQUIRE( node_1 );
+   put( node_1, 1, large );
+   put( node_1, 2, "two" );
+   put( node_1, 3, "three" );
+   db.finalize_node( node_1->id() );
+
+   auto object = node_1->get_shared_object( space, 1 );
+   BOOST_REQUIRE( object.key == object_key( 1 ) );
+   BOOST_REQUIRE_EQUAL( value_of( object ), large );
+
+   // Values in finalized nodes are shared rather than copied
+   BOOST_REQUIRE( node_1->get_shared_object( space, 1 ).value->data() == object.value->data() );
+   BOOST_REQUIRE( !node_1->get_shared_object( space, 4 ).value );
+
+   BOOST_TEST_MESSAGE( "Reading shared objects from a writable node" );
+   auto node_2 = db.create_writable_node( node_1->id(), crypto::hash( CRYPTO_SHA2_256_ID, 2 ) );
+   BOOST_REQUIRE( node_2 );
+   put( node_2, 2, "changed" );
+
+   auto two = node_2->get_shared_object( space, 2 );
+   BOOST_REQUIRE_EQUAL( value_of( two ), "changed" );
+   BOOST_REQUIRE( node_2->get_shared_object( space, 1 ).value->data() == object.value->data() );
+
+   // The writable node may still change its values, so they are copied
+   put( node_2, 2, "changed again" );
+   BOOST_REQUIRE_EQUAL( value_of( two ), "changed" );
+   BOOST_REQUIRE_EQUAL( value_of( node_2->get_shared_object( space, 2 ) ), "changed again" );
+
+   put_args.key = 3;
+   put_args.buf = nullptr;
+   node_2->put_object( put_res, put_args );
+   BOOST_REQUIRE( !node_2->get_shared_object( space, 3 ).value );
+   BOOST_REQUIRE_EQUAL( value_of( node_1->get_shared_object( space, 3 ) ), "three" );
+
+   BOOST_TEST_MESSAGE( "Iterating over shared objects" );
+   auto next = node_2->get_next_shared_object( space, 1 );
+   BOOST_REQUIRE( next.key == object_key( 2 ) );
+   BOOST_REQUIRE_EQUAL( value_of( next ), "changed again" );
+   BOOST_REQUIRE( !node_2->get_next_shared_object( space, 2 ).value );
+
+   auto prev = node_2->get_prev_shared_object( space, 2 );
+   BOOST_REQUIRE( prev.key == object_key( 1 ) );
+   BOOST_REQUIRE( prev.value->data() == object.value->data() );
+   BOOST_REQUIRE( !node_2->get_prev_shared_object( space, 1 ).value );
+
+   db.finalize_node( node_2->id() );
+
+   BOOST_TEST_MESSAGE( "Keeping shared objects past commit and discard" );
+   db.commit_node( node_1->id() );
+   auto latest = node_2->get_shared_object( space, 2 );
+   db.commit_node( node_2->id() );
+
+   BOOST_REQUIRE_EQUAL( value_of( object ), large );
+   BOOST_REQUIRE_EQUAL( value_of( latest ), "changed again" );
+   BOOST_REQUIRE_EQUAL( value_of( db.get_root()->get_shared_object( space, 1 ) ), large );
+   BOOST_REQUIRE_EQUAL( value_of( db.get_root()->get_shared_object( space, 2 ) ), "changed again" );
+   BOOST_REQUIRE( !db.get_root()->get_shared_object( space, 3 ).value );
+
+   // Head cannot be discarded, so discard the second of two children
+   auto node_3 = db.create_writable_node( node_2->id(), crypto::hash( CRYPTO_SHA2_256_ID, 3 ) );
+   BOOST_REQUIRE( node_3 );
+   db.finalize_node( node_3->id() );
+
+   auto node_4 = db.create_writable_node( node_2->id(), crypto::hash( CRYPTO_SHA2_256_ID, 4 ) );
+   BOOST_REQUIRE( node_4 );
+   put( node_4, 4, large );
+   db.finalize_node( node_4->id() );
+
+   auto four = node_4->get_shared_object( space, 4 );
+   db.discard_node( node_4->id() );
+   BOOST_REQUIRE_EQUAL( value_of( four ), large );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( id_set_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Checking id set membership and iteration" );
+   statedb::detail::id_set< uint64_t > ids;
+   std::set< uint64_t > expected;
+
+   BOOST_REQUIRE( ids.empty() );
+   BOOST_REQUIRE( !ids.contains( 0 ) );
+
+   for( uint64_t i = 0; i < 10000; ++i )
+   {
+      uint64_t id = statedb::detail::mix_hash( i ) % 5000;
+      BOOST_REQUIRE_EQUAL( ids.insert( id ), expected.insert( id ).second );
+   }
+
+   BOOST_REQUIRE_EQUAL( ids.size(), expected.size() );
+
+   for( uint64_t id = 0; id < 5000; ++id )
+      BOOST_REQUIRE_EQUAL( ids.contains( id ), expected.count( id ) == 1 );
+
+   BOOST_REQUIRE( std::set< uint64_t >( ids.begin(), ids.end() ) == expected );
+
+   ids.clear();
+   BOOST_REQUIRE( ids.empty() );
+   BOOST_REQUIRE( !ids.contains( *expected.begin() ) );
+
+   BOOST_TEST_MESSAGE( "Modifying many objects in a single node" );
+   object_space space = 0;
+   const uint64_t num_objects = 5000;
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   uint64_t value = 0;
+
+   auto put = [&]( state_node_ptr node, uint64_t key, const uint64_t* v )
+   {
+      put_args.space = space;
+      put_args.key = key;
+      put_args.buf = reinterpret_cast< const char* >( v );
+      put_args.object_size = v ? sizeof( *v ) : 0;
+      node->put_object( put_res, put_args );
+   };
+
+   auto node_1 = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, 1 ) );
+   for( uint64_t i = 0; i < num_objects; ++i )
+      put( node_1, i, &i );
+   db.finalize_node( node_1->id() );
+
+   auto node_2 = db.create_writable_node( node_1->id(), crypto::hash( CRYPTO_SHA2_256_ID, 2 ) );
+   for( uint64_t i = 0; i < num_objects; ++i )
+   {
+      uint64_t v = i + num_objects;
+      put( node_2, i, i % 3 ? &v : nullptr );
+   }
+   db.finalize_node( node_2->id() );
+
+   auto check_node = [&]( state_node_ptr node )
+   {
+      get_args.space = space;
+      get_args.buf = reinterpret_cast< char* >( &value );
+      get_args.buf_size = sizeof( value );
+
+      for( uint64_t i = 0; i < num_objects; ++i )
+      {
+         get_args.key = i;
+         node->get_object( get_res, get_args );
+
+         if( i % 3 )
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( value ) ) );
+            BOOST_REQUIRE_EQUAL( value, i + num_objects );
+         }
+         else
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+         }
+      }
+   };
+
+   check_node( node_2 );
+
+   db.commit_node( node_2->id() );
+   check_node( db.get_root() );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( concurrent_read_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Reading from head while blocks are committed" );
+   object_space space = 0;
+   const uint64_t num_blocks = 200;
+   const uint64_t num_readers = 4;
+   std::atomic< bool > done{ false };
+   std::atomic< uint64_t > reads{ 0 };
+   std::atomic< uint64_t > failures{ 0 };
+
+   auto writer = [&]()
+   {
+      put_object_args put_args;
+      put_object_result put_res;
+
+      for( uint64_t i = 1; i <= num_blocks; ++i )
+      {
+         auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, i ) );
+         BOOST_REQUIRE( node );
+
+         // Every block overwrites key 0 with its height and creates key i
+         put_args.space = space;
+         put_args.buf = reinterpret_cast< const char* >( &i );
+         put_args.object_size = sizeof( i );
+         put_args.key = 0;
+         node->put_object( put_res, put_args );
+         put_args.key = i;
+         node->put_object( put_res, put_args );
+
+         db.finalize_node( node->id() );
+
+         if( i > 4 )
+            db.commit_node( db.get_node_at_revision( i - 4 )->id() );
+
+         db.flatten_node( node->id(), 2 );
+      }
+
+      done = true;
+   };
+
+   // Boost.Test assertions are not thread safe, readers count failures instead
+   auto reader = [&]()
+   {
+      get_object_args get_args;
+      get_object_result get_res;
+      uint64_t value = 0;
+
+      get_args.space = space;
+      get_args.buf = reinterpret_cast< char* >( &value );
+      get_args.buf_size = sizeof( value );
+
+      try
+      {
+         while( !done )
+         {
+            auto head = db.get_head();
+            auto height = head->revision();
+
+            get_args.key = 0;
+            head->get_object( get_res, get_args );
+
+            if( height == 0 )
+            {
+               if( get_res.size != -1 )
+                  ++failures;
+               continue;
+            }
+
+            if( get_res.size != int64_t( sizeof( value ) ) || value != height )
+               ++failures;
+
+            get_args.key = height;
+            head->get_object( get_res, get_args );
+
+            if( get_res.size != int64_t( sizeof( value ) ) || value != height )
+               ++failures;
+
+            ++reads;
+         }
+      }
+      catch( ... )
+      {
+         ++failures;
+      }
+   };
+
+   std::vector< std::thread > readers;
+   for( uint64_t i = 0; i < num_readers; ++i )
+      readers.emplace_back( reader );
+
+   try
+   {
+      writer();
+   }
+   catch( ... )
+   {
+      done = true;
+      for( auto& t : readers )
+         t.join();
+      throw;
+   }
+
+   for( auto& t : readers )
+      t.join();
+
+   BOOST_REQUIRE_EQUAL( failures.load(), uint64_t( 0 ) );
+   BOOST_REQUIRE_EQUAL( db.get_head()->revision(), num_blocks );
+   BOOST_REQUIRE_EQUAL( db.get_root()->revision(), num_blocks - 4 );
+   BOOST_TEST_MESSAGE( "Completed " << reads.load() << " concurrent reads" );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( fixed_key_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Checking fixed keys order the same as their integers" );
+   using statedb::detail::fixed_key;
+
+   std::vector< uint256_t > values = { 0, 1, 255, 256, 65535, 65536 };
+   values.push_back( uint256_t( 1 ) << 64 );
+   values.push_back( ( uint256_t( 1 ) << 64 ) - 1 );
+   values.push_back( ( uint256_t( 1 ) << 128 ) + 7 );
+   values.push_back( uint256_t( 1 ) << 255 );
+   values.push_back( ~uint256_t( 0 ) );
+
+   for( uint64_t i = 0; i < 100; ++i )
+      values.push_back( ( uint256_t( statedb::detail::mix_hash( i ) ) << ( i % 193 ) ) | i );
+
+   for( const auto& a : values )
+   {
+      fixed_key ka( a );
+      BOOST_REQUIRE( ka.to_uint256() == a );
+
+      for( const auto& b : values )
+      {
+         fixed_key kb( b );
+         BOOST_REQUIRE_EQUAL( ka < kb, a < b );
+         BOOST_REQUIRE_EQUAL( ka == kb, a == b );
+      }
+   }
+
+   BOOST_TEST_MESSAGE( "Iterating keys that differ in higher bytes" );
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   uint64_t value = 1;
+
+   auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, 1 ) );
+   put_args.space = 1;
+   put_args.buf = reinterpret_cast< const char* >( &value );
+   put_args.object_size = sizeof( value );
+
+   std::vector< uint256_t > keys = { 255, 256, uint256_t( 1 ) << 64, uint256_t( 1 ) << 200 };
+   for( const auto& key : keys )
+   {
+      put_args.key = key;
+      node->put_object( put_res, put_args );
+   }
+
+   get_args.space = 1;
+   get_args.key = 0;
+   for( const auto& key : keys )
+   {
+      node->get_next_object( get_res, get_args );
+      BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( value ) ) );
+      BOOST_REQUIRE( get_res.key == key );
+      get_args.key = get_res.key;
+   }
+
+   node->get_next_object( get_res, get_args );
+   BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( legacy_migration_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Writing state with the legacy layout" );
+   const uint64_t num_objects = 100;
+   const uint64_t revision = 10;
+   const auto root_id = crypto::hash( CRYPTO_SHA2_256_ID, revision );
+
+   db.close();
+   std::filesystem::remove_all( temp );
+   std::filesystem::create_directory( temp );
+
+   {
+      statedb::detail::legacy::state_object_index legacy_index( statedb::detail::legacy::state_object_index::type_enum::mira );
+      legacy_index.open( temp, mira::utilities::default_database_configuration() );
+
+      // Ids are assigned in the reverse order of keys so that migration cannot rely on them
+      for( uint64_t i = 0; i < num_objects; ++i )
+      {
+         statedb::detail::legacy::state_object obj;
+         obj.id = num_objects - i;
+         obj.space = i % 2;
+         obj.key = i;
+         obj.value = object_value( i + 1, char( i ) );
+         BOOST_REQUIRE( legacy_index.emplace( std::move( obj ) ).second );
+      }
+
+      legacy_index.set_revision( revision );
+      legacy_index.put_metadata( ID_KEY, root_id );
+      legacy_index.close();
+   }
+
+   BOOST_TEST_MESSAGE( "Opening the legacy state" );
+   db.open( temp, mira::utilities::default_database_configuration() );
+   BOOST_REQUIRE( !std::filesystem::exists( temp / "rocksdb_state_object" ) );
+
+   auto root = db.get_root();
+   BOOST_REQUIRE_EQUAL( root->revision(), revision );
+   BOOST_REQUIRE( root->id() == root_id );
+
+   get_object_args get_args;
+   get_object_result get_res;
+   std::vector< char > buf( num_objects );
+
+   for( uint64_t i = 0; i < num_objects; ++i )
+   {
+      get_args.space = i % 2;
+      get_args.key = i;
+      get_args.buf = buf.data();
+      get_args.buf_size = buf.size();
+      root->get_object( get_res, get_args );
+
+      BOOST_REQUIRE_EQUAL( get_res.size, int64_t( i + 1 ) );
+      BOOST_REQUIRE( std::all_of( buf.begin(), buf.begin() + i + 1, [&]( char c ) { return c == char( i ); } ) );
+   }
+
+   BOOST_TEST_MESSAGE( "Checking migrated state survives reopening" );
+   db.close();
+   db.open( temp, mira::utilities::default_database_configuration() );
+   BOOST_REQUIRE_EQUAL( db.get_root()->revision(), revision );
+
+   get_args.space = 1;
+   get_args.key = num_objects - 1;
+   db.get_root()->get_object( get_res, get_args );
+   BOOST_REQUIRE_EQUAL( get_res.size, int64_t( num_objects ) );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( async_commit_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Building a chain of finalized nodes" );
+   object_space space = 0;
+   const uint64_t num_blocks = 12;
+   put_object_args put_args;
+   put_object_result put_res;
+   get_object_args get_args;
+   get_object_result get_res;
+   uint64_t value = 0;
+
+   std::vector< state_node_ptr > nodes;
+
+   for( uint64_t i = 1; i <= num_blocks; ++i )
+   {
+      auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, i ) );
+      BOOST_REQUIRE( node );
+
+      // Every block overwrites key 0, creates key i and removes key i - 2
+      put_args.space = space;
+      put_args.buf = reinterpret_cast< const char* >( &i );
+      put_args.object_size = sizeof( i );
+      put_args.key = 0;
+      node->put_object( put_res, put_args );
+      put_args.key = i;
+      node->put_object( put_res, put_args );
+
+      if( i > 2 )
+      {
+         put_args.key = i - 2;
+         put_args.buf = nullptr;
+         node->put_object( put_res, put_args );
+      }
+
+      db.finalize_node( node->id() );
+      nodes.push_back( node );
+   }
+
+   auto check_node = [&]( state_node_ptr node, uint64_t height )
+   {
+      get_args.space = space;
+      get_args.buf = reinterpret_cast< char* >( &value );
+      get_args.buf_size = sizeof( value );
+
+      for( uint64_t i = 0; i <= num_blocks; ++i )
+      {
+         get_args.key = i;
+         node->get_object( get_res, get_args );
+
+         if( i == 0 || ( i <= height && i + 2 > height ) )
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, int64_t( sizeof( value ) ) );
+            BOOST_REQUIRE_EQUAL( value, i == 0 ? height : i );
+         }
+         else
+         {
+            BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+         }
+      }
+   };
+
+   BOOST_TEST_MESSAGE( "Reading while commits are written" );
+   db.commit_node( nodes[ 3 ]->id() );
+   BOOST_REQUIRE( db.get_root()->id() == nodes[ 3 ]->id() );
+   BOOST_REQUIRE_EQUAL( db.get_root()->revision(), uint64_t( 4 ) );
+   BOOST_REQUIRE( db.get_root()->parent_id() == nodes[ 2 ]->id() );
+   check_node( db.get_root(), 4 );
+
+   BOOST_REQUIRE( db.flatten_node( nodes.back()->id(), 2 ) );
+   db.commit_node( nodes[ 7 ]->id() );
+   BOOST_REQUIRE_THROW( db.flatten_node( nodes[ 7 ]->id(), 0 ), illegal_argument );
+
+   for( uint64_t i = 8; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+   BOOST_TEST_MESSAGE( "Checking commits are written by flush" );
+   db.flush();
+   check_node( db.get_root(), 8 );
+
+   for( uint64_t i = 8; i <= num_blocks; ++i )
+      check_node( nodes[ i - 1 ], i );
+
+   BOOST_TEST_MESSAGE( "Checking committed state survives reopening" );
+   db.commit_node( nodes[ 9 ]->id() );
+   db.close();
+   db.open( temp, mira::utilities::default_database_configuration() );
+   BOOST_REQUIRE_EQUAL( db.get_root()->revision(), uint64_t( 10 ) );
+   BOOST_REQUIRE( db.get_root()->id() == nodes[ 9 ]->id() );
+   check_node( db.get_root(), 10 );
+
+   // Only key 0 and the two most recent keys are left
+   get_args.key = 0;
+   db.get_root()->get_next_object( get_res, get_args );
+   BOOST_REQUIRE( get_res.key == object_key( 9 ) );
+   get_args.key = get_res.key;
+   db.get_root()->get_next_object( get_res, get_args );
+   BOOST_REQUIRE( get_res.key == object_key( 10 ) );
+   get_args.key = get_res.key;
+   db.get_root()->get_next_object( get_res, get_args );
+   BOOST_REQUIRE_EQUAL( get_res.size, -1 );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
+BOOST_AUTO_TEST_CASE( metrics_test )
+{ try {
+   BOOST_TEST_MESSAGE( "Checking metrics of a new database" );
+   auto metrics = db.get_metrics();
+   BOOST_REQUIRE_EQUAL( metrics.nodes, uint64_t( 1 ) );
+   BOOST_REQUIRE_EQUAL( metrics.pending_commits, uint64_t( 0 ) );
+   BOOST_REQUIRE( metrics.database.columns.size() );
+   auto writes = metrics.database.writes;
+
+   BOOST_TEST_MESSAGE( "Checking metrics follow nodes and commits" );
+   auto node = db.create_writable_node( db.get_head()->id(), crypto::hash( CRYPTO_SHA2_256_ID, 1 ) );
+   BOOST_REQUIRE( node );
+
+   uint64_t value = 1;
+   put_object_args put_args;
+   put_object_result put_res;
+   put_args.space = 0;
+   put_args.key = 1;
+   put_args.buf = reinterpret_cast< const char* >( &value );
+   put_args.object_size = sizeof( value );
+   node->put_object( put_res, put_args );
+   db.finalize_node( node->id() );
+
+   BOOST_REQUIRE_EQUAL( db.get_metrics().nodes, uint64_t( 2 ) );
+
+   db.commit_node( node->id() );
+   BOOST_REQUIRE( db.get_metrics().database.columns.size() );
+   db.flush();
+
+   metrics = db.get_metrics();
+   BOOST_REQUIRE_EQUAL( metrics.nodes, uint64_t( 1 ) );
+   BOOST_REQUIRE_EQUAL( metrics.pending_commits, uint64_t( 0 ) );
+   BOOST_REQUIRE( metrics.database.writes > writes );
+
+} KOINOS_CATCH_LOG_AND_RETHROW(info) }
+
 BOOST_AUTO_TEST_SUITE_END()